@@ -5,7 +5,7 @@ namespace Chroma
 {
 
 void NeonWilsonDslash::packGauge(multi1d<LatticeColorMatrix> const& gauge,
-                          multi1d<GaugeMat>& packed /* out */)
+                          multi1d<PackedGaugeMat>& packed /* out */)
 {
     // assume packed is resized already
     size_t const sites = Layout::sitesOnNode();
@@ -13,16 +13,36 @@ void NeonWilsonDslash::packGauge(multi1d<LatticeColorMatrix> const& gauge,
     for (size_t i = 0; i < sites; ++i) {
         for (size_t d = 0; d < 4; ++d) {
             // packed[i + d] = gauge[d].elem(i);
+            Impl::GaugeMat link;
             for (size_t n = 0; n < 3; ++n) {
                 for (size_t m = 0; m < 3; ++m) {
-                    packed[i*4+d][n][m][0] = gauge[d].elem(i).elem().elem(m, n).real();
-                    packed[i*4+d][n][m][1] = gauge[d].elem(i).elem().elem(m, n).imag();
+                    link[n][m][0] = gauge[d].elem(i).elem().elem(m, n).real();
+                    link[n][m][1] = gauge[d].elem(i).elem().elem(m, n).imag();
                 }
             }
+            compressGauge<REAL>(link, packed[i*4+d]);
         }
     }
 }
 
+void NeonWilsonDslash::packClover(multi1d<PrimitiveClovTriang<REAL>> const& tri,
+                                  multi1d<PackedClover>& packed /* out */)
+{
+    size_t const sites = Layout::sitesOnNode();
+    packed.resize(sites);
+
+    for (size_t i = 0; i < sites; ++i) {
+        for (size_t b = 0; b < 2; ++b) {
+            for (size_t n = 0; n < 6; ++n) {
+                packed[i].diag[b][n] = tri[i].diag[b][n].elem();
+            }
+            for (size_t n = 0; n < 15; ++n) {
+                packed[i].offd[b][n][0] = tri[i].offd[b][n].real();
+                packed[i].offd[b][n][1] = tri[i].offd[b][n].imag();
+            }
+        }
+    }
+}
 
 
 //! Full constructor with general coefficients
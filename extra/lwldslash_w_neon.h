@@ -4,8 +4,11 @@
 #include "state.h"
 #include "io/aniso_io.h"
 #include "actions/ferm/linop/lwldslash_base_w.h"
+#include "actions/ferm/linop/clover_term_qdp_w.h"
 
 #include "neon_dslash.h"
+#include "neon_dslash_gauge.h"
+#include "neon_clover_dslash.h"
 
 namespace Chroma
 {
@@ -46,7 +49,7 @@ public:
 
     void apply(T& chi, const T& psi, PlusMinus isign, int cb) const {
         START_CODE();
-        impl.apply((float*)chi.getF(), (float*)psi.getF(), isign, cb); // use the OLattice backdoor
+        impl.apply((REAL*)chi.getF(), (REAL*)psi.getF(), isign, cb); // use the OLattice backdoor
         getFermBC().modifyF(chi, QDP::rb[cb]);
         END_CODE();
     }
@@ -54,20 +57,31 @@ public:
     //! Return the fermion BC object for this linear operator
     const FermBC<T,P,Q>& getFermBC() const {return *fbc;}
 
+    using PackedClover = PackedCloverT<REAL>;
+
+    //! Pack the triangular buffer of a QDPCloverTerm (A, or A^-1 after
+    //! choles) for NeonCloverDslashT, resizes packed to the sites on node
+    static void packClover(multi1d<PrimitiveClovTriang<REAL>> const& tri,
+                           multi1d<PackedClover>& /*out*/ packed);
+
 protected:
 
     //! Get the anisotropy parameters
     const multi1d<Real>& getCoeffs() const {return coeffs;}    
 
 private:
-    NeonDslash impl; // the real implementation
+    // same precision as LatticeFermion
+    using Impl = NeonDslashT<REAL>;
+    using PackedGaugeMat = Impl::PackedGauge; // compressed with --enable-gauge-compression
+
+    Impl impl; // the real implementation
     
     multi1d<Real> coeffs;
     Handle<FermBC<T,P,Q>> fbc;
-    multi1d<GaugeMat> packedGauge;
+    multi1d<PackedGaugeMat> packedGauge;
     
     static void packGauge(multi1d<LatticeColorMatrix> const& gauge,
-                          multi1d<GaugeMat>& /*out*/ packed);
+                          multi1d<PackedGaugeMat>& /*out*/ packed);
 };
 
 } // namespace Chroma
@@ -7,10 +7,26 @@
 namespace Chroma
 {
 
+// How the boundary half spinors travel between nodes
+enum HaloCompression {
+    HALO_UNCOMPRESSED=0,   // as they are stored in the comms buffers
+    HALO_FP16,             // packed to fp16
+    HALO_FP16_SCALED       // packed to fp16 relative to a float scale per site
+};
+
+// T is the floating point type of the operator, see HalfSpinorT.
+// N sources share the buffers and the messages: one message per direction
+// carries the boundary half spinors of all of them. faceBlocks[mu], if
+// given, replaces N as the number of half spinors per face site along mu
+template <typename T, int N = 1>
 class DslashTable
 {
 public:
-    DslashTable(int subgrid[]);
+    using HalfSpinorReal = typename HalfSpinorRealOf<T>::type;
+    using HalfSpinor = HalfSpinorBlockT<T, N>;
+
+    DslashTable(int subgrid[], HaloCompression compression = HALO_UNCOMPRESSED,
+                const int faceBlocks[] = 0);
     ~DslashTable();
 
     // Accessors
@@ -29,6 +45,11 @@ public:
     HalfSpinor*** getSendBufptr() {
         return (HalfSpinor***)send_bufptr;
     }
+
+    // N spinor fields on the whole subgrid (source r from r*volume) for the
+    // intermediate result of the operators made of two hops. allocated on
+    // first use
+    SpinorT<T>* getSpinorTmp();
     
     // Communications
     //
@@ -58,6 +79,9 @@ public:
                 QMP_error("sse_su3dslash_wilson: QMP_wait failed in forward direction");
                 QMP_abort(1);
             }
+            if (halo_compression != HALO_UNCOMPRESSED) {
+                unpackHalo(1);
+            }
         }
     }
 
@@ -69,6 +93,9 @@ public:
                 QMP_error("sse_su3dslash_wilson: QMP_wait failed in forward direction");
                 QMP_abort(1);
             }
+            if (halo_compression != HALO_UNCOMPRESSED) {
+                unpackHalo(0);
+            }
         }
     }
 	
@@ -76,6 +103,9 @@ public:
     inline void startSendBack() 
     { 
         if(total_comm > 0) {
+            if (halo_compression != HALO_UNCOMPRESSED) {
+                packHalo(1);
+            }
             if (QMP_start(send_all_mh[1]) != QMP_SUCCESS) {
                 QMP_error("sse_su3dslash_wilson: QMP_start failed in forward direction");
                 QMP_abort(1);
@@ -86,6 +116,9 @@ public:
     inline void startSendForward() 
     {
         if(total_comm > 0) {
+            if (halo_compression != HALO_UNCOMPRESSED) {
+                packHalo(0);
+            }
             if (QMP_start(send_all_mh[0]) != QMP_SUCCESS) {
                 QMP_error("sse_su3dslash_wilson: QMP_start failed in forward direction");
                 QMP_abort(1);
@@ -112,9 +145,27 @@ public:
             }
         }
     }
+
+    // the fused decomp sweep fills both send buffers at once, so both
+    // directions go out together
+    inline void startSends()
+    {
+        startSendForward();
+        startSendBack();
+    }
+
+    inline void finishSends()
+    {
+        finishSendForward();
+        finishSendBack();
+    }
 private:
 
-    static QMP_mem_t* xchi;
+    // HalfSpinors of the comms buffers <-> compressed wire buffers, threaded
+    void packHalo(int i);
+    void unpackHalo(int i);
+
+    QMP_mem_t* xchi;
     
     HalfSpinor *chi1;
     HalfSpinor *chi2;
@@ -135,6 +186,16 @@ private:
     QMP_msghandle_t recv_all_mh[4];
 
     int total_comm;   
+
+    int subgrid_vol;
+    QMP_mem_t* xtmp;
+    SpinorT<T>* spinor_tmp;
+
+    HaloCompression halo_compression;
+    QMP_mem_t* xwire;
+    int face_sites[2][4];   /* half spinors per message */
+    unsigned char* send_wire[2][4];
+    unsigned char* recv_wire[2][4];
 };
 
 
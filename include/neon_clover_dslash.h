@@ -0,0 +1,111 @@
+#ifndef NEON_CLOVER_DSLASH_H
+#define NEON_CLOVER_DSLASH_H
+
+#include "neon_dslash.h"
+
+namespace Chroma
+{
+
+// which packed clover field apply multiplies with
+enum CloverTerm {
+    CLOVER_A = 0,   // A D psi
+    CLOVER_A_INV    // A^-1 D psi, the even-odd Schur complement
+};
+
+// Wilson dslash followed by the clover term A or A^-1 of the target sites,
+// applied by the recons sweeps right after they store a site. this saves
+// the separate read and write of chi a clover pass would need.
+// the fields are packed with packClover (see PackedCloverT) on all sites
+// and, like the gauge field, are only views
+template <typename T, int N = 1>
+class NeonCloverDslashT : public NeonDslashT<T, N>
+{
+public:
+    using PackedGauge = typename NeonDslashT<T, N>::PackedGauge;
+    using PackedClover = PackedCloverT<T>;
+
+    //! Empty constructor. Must use create later
+    NeonCloverDslashT() = default;
+
+    // either clover field may be null if that term is never applied
+    void create(int subgrid[], /* int subgrid[4] */
+                PackedGauge* packedGauge,
+                PackedClover* clover,
+                PackedClover* invClover,
+                void (*getSiteCoords)(int coord[], int node, int linear),
+                int (*getLinearSiteIndex)(const int coord[]),
+                int (*getNodeNumber)(const int coord[]),
+                HaloCompression haloCompression = HALO_UNCOMPRESSED,
+                SiteOrder siteOrder = SITE_ORDER_LEXICOGRAPHIC,
+                FieldLayout fieldLayout = FIELD_LAYOUT_QDP,
+                GaugeLayout gaugeLayout = GAUGE_SINGLE)
+    {
+        NeonDslashT<T, N>::create(subgrid, packedGauge,
+                                  getSiteCoords, getLinearSiteIndex, getNodeNumber,
+                                  haloCompression, siteOrder, fieldLayout,
+                                  gaugeLayout);
+        packedClover = clover;
+        packedInvClover = invClover;
+    }
+
+    // the plain hopping term
+    using NeonDslashT<T, N>::apply;
+    using NeonDslashT<T, N>::applyAxpby;
+
+    // chi[r] = A D psi[r] or A^-1 D psi[r] for the N sources r
+    void apply(T* const chi[], T* const psi[], int isign, int cb, CloverTerm term) const
+    {
+        typename NeonDslashT<T, N>::SweepEpilogue ep{};
+        ep.clover = cloverField(term);
+        this->applyFused(chi, psi, isign, cb, ep);
+    }
+
+    void apply(T* chi, T* psi, int isign, int cb, CloverTerm term) const
+    {
+        static_assert(N == 1, "NeonCloverDslashT: pass N fields");
+        apply(&chi, &psi, isign, cb, term);
+    }
+
+    // chi[r] = a x[r] + b A D psi[r] (or A^-1). x may be psi but not chi
+    void applyAxpby(T* const chi[], T a, T* const x[], T b, T* const psi[],
+                    int isign, int cb, CloverTerm term) const
+    {
+        SpinorT<T>* xs[N];
+        for (int r = 0; r < N; ++r) {
+            xs[r] = (SpinorT<T>*) x[r];
+        }
+        typename NeonDslashT<T, N>::SweepEpilogue ep{};
+        ep.clover = cloverField(term);
+        ep.x = xs;
+        ep.a = a;
+        ep.b = b;
+        this->applyFused(chi, psi, isign, cb, ep);
+    }
+
+    void applyAxpby(T* chi, T a, T* x, T b, T* psi, int isign, int cb, CloverTerm term) const
+    {
+        static_assert(N == 1, "NeonCloverDslashT: pass N fields");
+        applyAxpby(&chi, a, &x, b, &psi, isign, cb, term);
+    }
+
+private:
+    PackedClover const* cloverField(CloverTerm term) const
+    {
+        PackedClover const* clover = term == CLOVER_A_INV ? packedInvClover : packedClover;
+        if (clover == 0) {
+            QMP_error("NeonCloverDslash: no packed clover field for this term");
+            QMP_abort(1);
+        }
+        return clover;
+    }
+
+    PackedClover* packedClover = 0;     // only views. not owned.
+    PackedClover* packedInvClover = 0;
+};
+
+using NeonCloverDslash = NeonCloverDslashT<float>;
+using NeonCloverDslashD = NeonCloverDslashT<double>;
+
+} // namespace Chroma
+
+#endif // NEON_CLOVER_DSLASH_H
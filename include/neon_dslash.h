@@ -10,30 +10,165 @@
 namespace Chroma
 {
 
-// single floating point only
-class NeonDslash
+// where the operator finds the sites of the fields
+enum FieldLayout {
+    FIELD_LAYOUT_QDP=0,     // the site order of getLinearSiteIndex
+    FIELD_LAYOUT_INTERNAL   // the order of the sweeps, see importSpinor
+};
+
+// how the operator keeps the links
+enum GaugeLayout {
+    GAUGE_SINGLE=0,         // U(x, mu) of each site
+    GAUGE_DOUBLE_STORED     // a copy with U(x - mu, mu) next to U(x, mu),
+                            // see applyFused
+};
+
+// T = float or double. the half spinor temporaries and the halos have the
+// same precision (fp16 halves need DSLASH_HALF_CHI and T = float)
+// N sources are applied together: each link is loaded once per site for
+// all of them and their halos travel in one message per direction.
+// instantiated for N = 1, 2, 4, 8, 12, 16, 20 and 24
+template <typename T, int N = 1>
+class NeonDslashT
 {
 public:
+    using Spinor = SpinorT<T>;
+    using HalfSpinor = HalfSpinorBlockT<T, N>;
+    using GaugeMat = GaugeMatT<T>;
+    using PackedGauge = PackedGaugeT<T>; // GaugeMat unless compressed
+    using PackedClover = PackedCloverT<T>;
+    using SweepEpilogue = SweepEpilogueT<T>;
+
+    // reductions of the result fused into the last sweeps, per source r
+    // over the target checkerboard: norm2[r] = |chi[r]|^2 and, when y is
+    // set, dot[r] = <y[r], chi[r]>. summed over the nodes when global
+    struct Reduction
+    {
+        T* const* y = 0;
+        bool global = true;
+        double norm2[N];
+        double dot[N][2];
+    };
 
     //! Empty constructor. Must use create later
-    NeonDslash() = default;
+    NeonDslashT() = default;
+    ~NeonDslashT()
+    {
+        if (xgauge != 0) {
+            QMP_free_memory(xgauge);
+        }
+        if (xgauge8 != 0) {
+            QMP_free_memory(xgauge8);
+        }
+    }
+
+    // siteOrder is the order of the sweeps over the sites, see SiteOrder.
+    // with FIELD_LAYOUT_INTERNAL the operator keeps the links in that order
+    // and all the fields it is passed (sources, results, x, y, clover terms)
+    // must be in it too, so the sweeps read and write them sequentially.
+    // GAUGE_DOUBLE_STORED takes twice the memory of the links.
+    // the operators with the same subgrid, layout functions and options
+    // share their tables and comms buffers (and the temporary of
+    // applySchur), so they must not be applied concurrently
     void create(int subgrid[], /* int subgrid[4] */
-                GaugeMat* packedGauge,
+                PackedGauge* packedGauge,
                 void (*getSiteCoords)(int coord[], int node, int linear),
                 int (*getLinearSiteIndex)(const int coord[]),
-                int (*getNodeNumber)(const int coord[]));
+                int (*getNodeNumber)(const int coord[]),
+                HaloCompression haloCompression = HALO_UNCOMPRESSED,
+                SiteOrder siteOrder = SITE_ORDER_LEXICOGRAPHIC,
+                FieldLayout fieldLayout = FIELD_LAYOUT_QDP,
+                GaugeLayout gaugeLayout = GAUGE_SINGLE);
+
+    // FIELD_LAYOUT_INTERNAL or GAUGE_DOUBLE_STORED: copy the links into the
+    // operator, again after they changed
+    void importGauge(const PackedGauge* packedGauge);
+
+    // a field on both checkerboards in the site order of getLinearSiteIndex
+    // to / from the internal layout, threaded
+    void importSpinor(T* internal, const T* psi) const;
+    void exportSpinor(T* psi, const T* internal) const;
+    void importClover(PackedClover* internal, const PackedClover* clover) const;
     
-    void apply(float* chi, float* psi, int isign, int cb) const;
+    // the StreamingStores of the sweeps, none by default
+    void setStreamingStores(int phases)
+    {
+        streamingStores = phases;
+    }
+
+    // chi[r] = D psi[r] for the N sources r
+    void apply(T* const chi[], T* const psi[], int isign, int cb) const;
+
+    void apply(T* chi, T* psi, int isign, int cb) const
+    {
+        static_assert(N == 1, "NeonDslashT: pass N fields");
+        apply(&chi, &psi, isign, cb);
+    }
 
+    void apply(T* const chi[], T* const psi[], int isign, int cb, Reduction& red) const;
+
+    // chi[r] = a x[r] + b D psi[r] on checkerboard cb, the axpy of the
+    // solvers done by the recons sweeps. x may be psi but not chi
+    void applyAxpby(T* const chi[], T a, T* const x[], T b, T* const psi[],
+                    int isign, int cb) const;
+
+    void applyAxpby(T* chi, T a, T* x, T b, T* psi, int isign, int cb) const
+    {
+        static_assert(N == 1, "NeonDslashT: pass N fields");
+        applyAxpby(&chi, a, &x, b, &psi, isign, cb);
+    }
+
+    // the even-odd preconditioned operator on checkerboard cb,
+    // chi[r] = psi[r] - kappa^2 D D psi[r], and its dagger for isign = -1.
+    // the first hop's result on 1 - cb stays in a temporary of the operator
+    // and the axpy is done by the last recons sweeps. chi must not alias psi
+    void applySchur(T* const chi[], T* const psi[], T kappa, int isign, int cb) const;
+
+    void applySchur(T* chi, T* psi, T kappa, int isign, int cb) const
+    {
+        static_assert(N == 1, "NeonDslashT: pass N fields");
+        applySchur(&chi, &psi, kappa, isign, cb);
+    }
+
+    // with the reductions of chi, e.g. |chi|^2 and <psi, chi> for CG
+    void applySchur(T* const chi[], T* const psi[], T kappa, int isign, int cb,
+                    Reduction& red) const;
+
+protected:
+    // apply with the epilogue ep on the target sites, fused into the
+    // recons sweeps. a zero SweepEpilogue is the plain Wilson operator.
+    // red, if not null, takes the place of ep.y and ep.sums.
+    // with GAUGE_DOUBLE_STORED the decomp only does the face sites and the
+    // targets gather the hops of their on node neighbours from psi in a
+    // single sweep, without the round trip through chi1 and chi2
+    // (not for the source mix of NeonMobiusDslashT, which takes the
+    // decomp and recons sweeps)
+    void applyFused(T* const chi[], T* const psi[], int isign, int cb,
+                    SweepEpilogue const& ep, Reduction* red = 0) const;
+
+    // applySchur with the epilogue hop on the first hop and last on the
+    // second, last.x, a and b are set for the axpy with psi
+    void applySchurFused(T* const chi[], T* const psi[], T kappa, int isign, int cb,
+                         SweepEpilogue const& hop, SweepEpilogue last,
+                         Reduction* red) const;
 
 private:
-    GaugeMat* packedGauge; // only a view. not owned.
+
+    PackedGauge* packedGauge; // only a view. not owned, unless internal
+    QMP_mem_t* xgauge = 0;    // the links in the internal layout
+    QMP_mem_t* xgauge8 = 0;   // GAUGE_DOUBLE_STORED: [site][mu], then [site][4 + mu]
+    int streamingStores = STREAM_NONE;
+
+    void doubleStoreGauge();
 
     // extra needed:
-    std::unique_ptr<DslashTable> dslashTable;
-    std::unique_ptr<ShiftTable> shiftTable;   
+    std::shared_ptr<DslashTable<T, N>> dslashTable;
+    std::shared_ptr<ShiftTable<T, N>> shiftTable;   
 };
 
+using NeonDslash = NeonDslashT<float>;
+using NeonDslashD = NeonDslashT<double>;
+
 } // namespace Chroma
 
 #endif // NEONDSLASH_H
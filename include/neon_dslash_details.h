@@ -2,33 +2,73 @@
 #define NEON_DSLASH_DETAILS_H
 
 // header only library
-#include <arm_neon.h>
+#include "neon_dslash_simd.h"
 #include "neon_dslash_types.h"
 
 namespace
 {
-using Chroma::GaugeMat;
-using Chroma::Spinor;
-using Chroma::HalfSpinor;
+using namespace Chroma::Simd;
+
+// half spinor loads and stores, converting when the temporaries are fp16
+inline vfloat4 vld_hs(const uint16_t* p) { return vld_f16(p); }
+inline void vst_hs(uint16_t* p, vfloat4 v) { vst_f16(p, v); }
+inline vfloat4 vld_hs(const float* p) { return vld(p); }
+inline void vst_hs(float* p, vfloat4 v) { vst(p, v); }
+inline vdouble4 vld_hs(const double* p) { return vld(p); }
+inline void vst_hs(double* p, vdouble4 v) { vst(p, v); }
+
+using Chroma::GaugeMatT;
+using Chroma::SpinorT;
+using Chroma::HalfSpinorT;
+
+// software prefetch of the data a site loop reaches through the shift
+// table DSLASH_PREFETCH_DISTANCE sites ahead: the indirect accesses are
+// invisible to the hardware prefetchers. 0 turns it off
+#ifndef DSLASH_PREFETCH_DISTANCE
+#define DSLASH_PREFETCH_DISTANCE 4
+#endif
+
+constexpr int prefetchDistance = DSLASH_PREFETCH_DISTANCE;
+
+// the cache lines of an object to be read (Write = 0) or written
+template <int Write, typename P>
+inline void prefetch_lines(P const& obj)
+{
+    uintptr_t begin = (uintptr_t) &obj;
+    uintptr_t line = begin & ~(uintptr_t)(Chroma::Cache::CacheLineSize - 1);
+    for (; line < begin + sizeof(P); line += Chroma::Cache::CacheLineSize) {
+        __builtin_prefetch((void const*) line, Write, 3);
+    }
+}
+
+// bits of a sign mask lane for vld_mask
+template <typename T>
+using SignBits = typename VecTraits<T>::mask_bits;
+
+template <typename T>
+constexpr SignBits<T> signBit() { return VecTraits<T>::sign; }
 
-inline void reverse_real_img(float32x4_t& vec1, float32x4_t& vec2, float32x4_t& vec3)
+template <typename V>
+inline void reverse_real_img(V& vec1, V& vec2, V& vec3)
 {
-    vec1 = vrev64q_f32(vec1);
-    vec2 = vrev64q_f32(vec2);
-    vec3 = vrev64q_f32(vec3);
+    vec1 = vrev64(vec1);
+    vec2 = vrev64(vec2);
+    vec3 = vrev64(vec3);
 }
 
-inline void reverse_elements(float32x4_t& v1, float32x4_t& v2, float32x4_t& v3)
+template <typename V>
+inline void reverse_elements(V& v1, V& v2, V& v3)
 {
     // swap lower half and higher half
-    v1 = vextq_f32(v1, v1, 2);
-    v2 = vextq_f32(v2, v2, 2);
-    v3 = vextq_f32(v3, v3, 2);
+    v1 = vext2(v1, v1);
+    v2 = vext2(v2, v2);
+    v3 = vext2(v3, v3);
     reverse_real_img(v1, v2, v3);
 }
 
 // hope it's inlined
-inline void swizzle(float32x4_t& vec1, float32x4_t& vec2, float32x4_t& vec3)
+template <typename V>
+inline void swizzle(V& vec1, V& vec2, V& vec3)
 {
     // original:
     // vec1: 00re 00img 01re 01img
@@ -40,11 +80,11 @@ inline void swizzle(float32x4_t& vec1, float32x4_t& vec2, float32x4_t& vec3)
     // vec2: 01re 01img 11re 11img
     // vec3: 02re 02img 12re 12img
         
-    float32x4_t t1 = vextq_f32(vec2, vec1, 2);
-    t1 = vextq_f32(t1, t1, 2); // swap the higher half and the lower half
-    float32x4_t t2 = vextq_f32(vec1, vec3, 2);
-    float32x4_t t3 = vextq_f32(vec3, vec2, 2);
-    t3 = vextq_f32(t3, t3, 2);
+    V t1 = vext2(vec2, vec1);
+    t1 = vext2(t1, t1); // swap the higher half and the lower half
+    V t2 = vext2(vec1, vec3);
+    V t3 = vext2(vec3, vec2);
+    t3 = vext2(t3, t3);
     
     vec1 = t1;
     vec2 = t2;
@@ -52,7 +92,8 @@ inline void swizzle(float32x4_t& vec1, float32x4_t& vec2, float32x4_t& vec3)
 }
 
 // just like swizzle, but the low part and the high part are swapped
-inline void swizzle2(float32x4_t& vec1, float32x4_t& vec2, float32x4_t& vec3)
+template <typename V>
+inline void swizzle2(V& vec1, V& vec2, V& vec3)
 {
     // original:
     // vec1: 00re 00img 01re 01img
@@ -63,10 +104,10 @@ inline void swizzle2(float32x4_t& vec1, float32x4_t& vec2, float32x4_t& vec3)
     // vec1: 10re 10img 00re 00img
     // vec2: 11re 11img 01re 01img
     // vec3: 12re 12img 02re 02img
-    float32x4_t t1 = vextq_f32(vec2, vec1, 2);
-    float32x4_t t3 = vextq_f32(vec3, vec2, 2);
-    float32x4_t t2 = vextq_f32(vec1, vec3, 2);
-    t2 = vextq_f32(t2, t2, 2);
+    V t1 = vext2(vec2, vec1);
+    V t3 = vext2(vec3, vec2);
+    V t2 = vext2(vec1, vec3);
+    t2 = vext2(t2, t2);
     
     vec1 = t1;
     vec2 = t2;
@@ -74,88 +115,90 @@ inline void swizzle2(float32x4_t& vec1, float32x4_t& vec2, float32x4_t& vec3)
 }
 
 // the inverse operation of swizzle
-inline void deswizzle(float32x4_t& v1, float32x4_t& v2, float32x4_t& v3)
+template <typename V>
+inline void deswizzle(V& v1, V& v2, V& v3)
 {
-    float32x4_t t1 = vextq_f32(v1, v1, 2);
-    float32x4_t t3 = vextq_f32(v3, v3, 2);
+    V t1 = vext2(v1, v1);
+    V t3 = vext2(v3, v3);
 
-    v1 = vextq_f32(t1, v2, 2);
-    v3 = vextq_f32(v2, t3, 2);
-    v2 = vextq_f32(t3, t1, 2);
+    v1 = vext2(t1, v2);
+    v3 = vext2(v2, t3);
+    v2 = vext2(t3, t1);
 }
 
 // can be inline function or macro
-inline void change_sign(float32x4_t& v1, float32x4_t& v2, float32x4_t& v3,
-                        uint32x4_t signs)
+template <typename V, typename M>
+inline void change_sign(V& v1, V& v2, V& v3, M signs)
 {
-    v1 = vreinterpretq_f32_u32(veorq_u32(vreinterpretq_u32_f32(v1), signs));
-    v2 = vreinterpretq_f32_u32(veorq_u32(vreinterpretq_u32_f32(v2), signs));
-    v3 = vreinterpretq_f32_u32(veorq_u32(vreinterpretq_u32_f32(v3), signs));
+    v1 = veor(v1, signs);
+    v2 = veor(v2, signs);
+    v3 = veor(v3, signs);
 }
 
 // adj(3x3 color matrix) * halfspinor
 // halfspinor in hs1 hs2 hs3
 // result is also in hs1 hs2 hs3
-void mat_hvv(float32x4_t& hs1, float32x4_t& hs2, float32x4_t& hs3,
-             GaugeMat mat)
+template <typename T>
+void mat_hvv(vreal4<T>& hs1, vreal4<T>& hs2, vreal4<T>& hs3,
+             GaugeMatT<T> const mat)
 {
-    static uint32_t signs24UInt[4] __attribute__((aligned(16))) = {0x0, 0x80000000, 0x0, 0x80000000};
-    uint32x4_t signs24 = vld1q_u32(signs24UInt);
+    static const SignBits<T> signs24Bits[4] __attribute__((aligned(32))) = {0, signBit<T>(), 0, signBit<T>()};
+    auto signs24 = vld_mask(signs24Bits);
 
-    float32x4_t v1 = hs1;
-    float32x4_t v2 = hs2;
-    float32x4_t v3 = hs3;
+    vreal4<T> v1 = hs1;
+    vreal4<T> v2 = hs2;
+    vreal4<T> v3 = hs3;
 
-    float32x4_t m1 = vld1q_dup_f32((float*)&mat[0][0][0]);
-    float32x4_t m2 = vld1q_dup_f32((float*)&mat[1][0][0]);
-    float32x4_t m3 = vld1q_dup_f32((float*)&mat[2][0][0]);
+    vreal4<T> m1 = vld_dup(&mat[0][0][0]);
+    vreal4<T> m2 = vld_dup(&mat[1][0][0]);
+    vreal4<T> m3 = vld_dup(&mat[2][0][0]);
 
-    float32x4_t acc1 = vmulq_f32(m1, v1);
-    float32x4_t acc2 = vmulq_f32(m2, v1);
-    float32x4_t acc3 = vmulq_f32(m3, v1);
+    vreal4<T> acc1 = vmul(m1, v1);
+    vreal4<T> acc2 = vmul(m2, v1);
+    vreal4<T> acc3 = vmul(m3, v1);
 
-    m1 = vld1q_dup_f32((float*)&mat[0][1][0]);
-    m2 = vld1q_dup_f32((float*)&mat[1][1][0]);
-    m3 = vld1q_dup_f32((float*)&mat[2][1][0]);
+    m1 = vld_dup(&mat[0][1][0]);
+    m2 = vld_dup(&mat[1][1][0]);
+    m3 = vld_dup(&mat[2][1][0]);
 
-    acc1 = vfmaq_f32(acc1, m1, v2);
-    acc2 = vfmaq_f32(acc2, m2, v2);
-    acc3 = vfmaq_f32(acc3, m3, v2);
+    acc1 = vfma(acc1, m1, v2);
+    acc2 = vfma(acc2, m2, v2);
+    acc3 = vfma(acc3, m3, v2);
 
-    m1 = vld1q_dup_f32((float*)&mat[0][2][0]);
-    m2 = vld1q_dup_f32((float*)&mat[1][2][0]);
-    m3 = vld1q_dup_f32((float*)&mat[2][2][0]);
+    m1 = vld_dup(&mat[0][2][0]);
+    m2 = vld_dup(&mat[1][2][0]);
+    m3 = vld_dup(&mat[2][2][0]);
 
-    acc1 = vfmaq_f32(acc1, m1, v3);
-    acc2 = vfmaq_f32(acc2, m2, v3);
-    acc3 = vfmaq_f32(acc3, m3, v3);
+    acc1 = vfma(acc1, m1, v3);
+    acc2 = vfma(acc2, m2, v3);
+    acc3 = vfma(acc3, m3, v3);
 
     // adj means conjugate, a+bi => a-bi
     reverse_real_img(v1, v2, v3);
     change_sign(v1, v2, v3, signs24);
 
-    m1 = vld1q_dup_f32((float*)&mat[0][0][1]);
-    m2 = vld1q_dup_f32((float*)&mat[1][0][1]);
-    m3 = vld1q_dup_f32((float*)&mat[2][0][1]);
+    m1 = vld_dup(&mat[0][0][1]);
+    m2 = vld_dup(&mat[1][0][1]);
+    m3 = vld_dup(&mat[2][0][1]);
 
-    acc1 = vfmaq_f32(acc1, m1, v1);
-    acc2 = vfmaq_f32(acc2, m2, v1);
-    acc3 = vfmaq_f32(acc3, m3, v1);
+    acc1 = vfma(acc1, m1, v1);
+    acc2 = vfma(acc2, m2, v1);
+    acc3 = vfma(acc3, m3, v1);
 
-    m1 = vld1q_dup_f32((float*)&mat[0][1][1]);
-    m2 = vld1q_dup_f32((float*)&mat[1][1][1]);
-    m3 = vld1q_dup_f32((float*)&mat[2][1][1]);
+    m1 = vld_dup(&mat[0][1][1]);
+    m2 = vld_dup(&mat[1][1][1]);
+    m3 = vld_dup(&mat[2][1][1]);
 
-    acc1 = vfmaq_f32(acc1, m1, v2);
-    acc2 = vfmaq_f32(acc2, m2, v2);
-    acc3 = vfmaq_f32(acc3, m3, v2);
+    acc1 = vfma(acc1, m1, v2);
+    acc2 = vfma(acc2, m2, v2);
+    acc3 = vfma(acc3, m3, v2);
 
-    m1 = vld1q_dup_f32((float*)&mat[0][2][1]);
-    m2 = vld1q_dup_f32((float*)&mat[1][2][1]);
-    m3 = vld1q_dup_f32((float*)&mat[2][2][1]);
-    acc1 = vfmaq_f32(acc1, m1, v3);
-    acc2 = vfmaq_f32(acc2, m2, v3);
-    acc3 = vfmaq_f32(acc3, m3, v3);
+    m1 = vld_dup(&mat[0][2][1]);
+    m2 = vld_dup(&mat[1][2][1]);
+    m3 = vld_dup(&mat[2][2][1]);
+    acc1 = vfma(acc1, m1, v3);
+    acc2 = vfma(acc2, m2, v3);
+    acc3 = vfma(acc3, m3, v3);
 
     // done
     hs1 = acc1;
@@ -166,64 +209,65 @@ void mat_hvv(float32x4_t& hs1, float32x4_t& hs2, float32x4_t& hs3,
 // 3x3 color matrix * halfspinor
 // halfspinor in hs1 hs2 hs3
 // result is also in hs1 hs2 hs3
-void mat_mvv(float32x4_t& hs1, float32x4_t& hs2, float32x4_t& hs3,
-             GaugeMat mat)
+template <typename T>
+void mat_mvv(vreal4<T>& hs1, vreal4<T>& hs2, vreal4<T>& hs3,
+             GaugeMatT<T> const mat)
 {
-    static uint32_t signs13UInt[] = {0x80000000, 0x0, 0x80000000, 0x0};
-    uint32x4_t signs13 = vld1q_u32(signs13UInt);
+    static const SignBits<T> signs13Bits[4] __attribute__((aligned(32))) = {signBit<T>(), 0, signBit<T>(), 0};
+    auto signs13 = vld_mask(signs13Bits);
     
-    float32x4_t m1, m2, m3;
-    m1 = vld1q_dup_f32((float*)&mat[0][0][0]);
-    m2 = vld1q_dup_f32((float*)&mat[0][1][0]);
-    m3 = vld1q_dup_f32((float*)&mat[0][2][0]);
+    vreal4<T> m1, m2, m3;
+    m1 = vld_dup(&mat[0][0][0]);
+    m2 = vld_dup(&mat[0][1][0]);
+    m3 = vld_dup(&mat[0][2][0]);
 
-    float32x4_t acc1, acc2, acc3;
-    acc1 = vmulq_f32(m1, hs1);
-    acc2 = vmulq_f32(m2, hs1);
-    acc3 = vmulq_f32(m3, hs1);
+    vreal4<T> acc1, acc2, acc3;
+    acc1 = vmul(m1, hs1);
+    acc2 = vmul(m2, hs1);
+    acc3 = vmul(m3, hs1);
 
-    m1 = vld1q_dup_f32((float*)&mat[1][0][0]);
-    m2 = vld1q_dup_f32((float*)&mat[1][1][0]);
-    m3 = vld1q_dup_f32((float*)&mat[1][2][0]);
+    m1 = vld_dup(&mat[1][0][0]);
+    m2 = vld_dup(&mat[1][1][0]);
+    m3 = vld_dup(&mat[1][2][0]);
 
-    acc1 = vfmaq_f32(acc1, m1, hs2);
-    acc2 = vfmaq_f32(acc2, m2, hs2);
-    acc3 = vfmaq_f32(acc3, m3, hs2);
+    acc1 = vfma(acc1, m1, hs2);
+    acc2 = vfma(acc2, m2, hs2);
+    acc3 = vfma(acc3, m3, hs2);
 
-    m1 = vld1q_dup_f32((float*)&mat[2][0][0]);
-    m2 = vld1q_dup_f32((float*)&mat[2][1][0]);
-    m3 = vld1q_dup_f32((float*)&mat[2][2][0]);
+    m1 = vld_dup(&mat[2][0][0]);
+    m2 = vld_dup(&mat[2][1][0]);
+    m3 = vld_dup(&mat[2][2][0]);
 
-    acc1 = vfmaq_f32(acc1, m1, hs3);
-    acc2 = vfmaq_f32(acc2, m2, hs3);
-    acc3 = vfmaq_f32(acc3, m3, hs3);
+    acc1 = vfma(acc1, m1, hs3);
+    acc2 = vfma(acc2, m2, hs3);
+    acc3 = vfma(acc3, m3, hs3);
 
     reverse_real_img(hs1, hs2, hs3);
     change_sign(hs1, hs2, hs3, signs13);
 
-    m1 = vld1q_dup_f32((float*)&mat[0][0][1]);
-    m2 = vld1q_dup_f32((float*)&mat[0][1][1]);
-    m3 = vld1q_dup_f32((float*)&mat[0][2][1]);
+    m1 = vld_dup(&mat[0][0][1]);
+    m2 = vld_dup(&mat[0][1][1]);
+    m3 = vld_dup(&mat[0][2][1]);
 
-    acc1 = vfmaq_f32(acc1, m1, hs1);
-    acc2 = vfmaq_f32(acc2, m2, hs1);
-    acc3 = vfmaq_f32(acc3, m3, hs1);
+    acc1 = vfma(acc1, m1, hs1);
+    acc2 = vfma(acc2, m2, hs1);
+    acc3 = vfma(acc3, m3, hs1);
 
-    m1 = vld1q_dup_f32((float*)&mat[1][0][1]);
-    m2 = vld1q_dup_f32((float*)&mat[1][1][1]);
-    m3 = vld1q_dup_f32((float*)&mat[1][2][1]);
+    m1 = vld_dup(&mat[1][0][1]);
+    m2 = vld_dup(&mat[1][1][1]);
+    m3 = vld_dup(&mat[1][2][1]);
 
-    acc1 = vfmaq_f32(acc1, m1, hs2);
-    acc2 = vfmaq_f32(acc2, m2, hs2);
-    acc3 = vfmaq_f32(acc3, m3, hs2);
+    acc1 = vfma(acc1, m1, hs2);
+    acc2 = vfma(acc2, m2, hs2);
+    acc3 = vfma(acc3, m3, hs2);
 
-    m1 = vld1q_dup_f32((float*)&mat[2][0][1]);
-    m2 = vld1q_dup_f32((float*)&mat[2][1][1]);
-    m3 = vld1q_dup_f32((float*)&mat[2][2][1]);
+    m1 = vld_dup(&mat[2][0][1]);
+    m2 = vld_dup(&mat[2][1][1]);
+    m3 = vld_dup(&mat[2][2][1]);
 
-    acc1 = vfmaq_f32(acc1, m1, hs3);
-    acc2 = vfmaq_f32(acc2, m2, hs3);
-    acc3 = vfmaq_f32(acc3, m3, hs3);
+    acc1 = vfma(acc1, m1, hs3);
+    acc2 = vfma(acc2, m2, hs3);
+    acc3 = vfma(acc3, m3, hs3);
 
     // done
     hs1 = acc1;
@@ -231,411 +275,248 @@ void mat_mvv(float32x4_t& hs1, float32x4_t& hs2, float32x4_t& hs3,
     hs3 = acc3;
 }
 
-// (a0-i*a3, a1-i*a2)
-void decomp_gamma0_minus_impl(Spinor src,
-                              float32x4_t& res1, float32x4_t& res2,
-                              float32x4_t& res3)
+// load a spinor and bring it into the halfspinor friendly order
+// upper: swizzled spin 0 and 1
+// lower: swizzled spin 2 and 3
+// lower2: spin 2 and 3 with swizzle2, i.e. spin 3 in the low half
+template <typename T>
+inline void load_swizzled(SpinorT<T> src, vreal4<T> upper[3],
+                          vreal4<T> lower[3], vreal4<T> lower2[3])
 {
-    static uint32_t signs24UInt[4] __attribute__((aligned(16))) = {0x00000000, 0x80000000, 0x00000000, 0x80000000};
-    uint32x4_t signs24 = vld1q_u32(signs24UInt);
-    
-    float32x4_t vec1, vec2, vec3, vec4, vec5, vec6;
-    vec1 = vld1q_f32((float*)&src[0][0][0]);
-    vec2 = vld1q_f32((float*)&src[0][2][0]);
-    vec3 = vld1q_f32((float*)&src[1][1][0]);
-    vec4 = vld1q_f32((float*)&src[2][0][0]);
-    vec5 = vld1q_f32((float*)&src[2][2][0]);
-    vec6 = vld1q_f32((float*)&src[3][1][0]);
-
-    swizzle(vec1, vec2, vec3);
-    swizzle2(vec4, vec5, vec6);
-
-    // * i ==> reverse_real_img
-    reverse_real_img(vec4, vec5, vec6);
-    
-    // make the second lane and fourth lane negative
-    change_sign(vec4, vec5, vec6, signs24);
-
-    // result in res1 res2 res3
-    res1 = vaddq_f32(vec1, vec4);
-    res2 = vaddq_f32(vec2, vec5);
-    res3 = vaddq_f32(vec3, vec6);
+    upper[0] = vld(&src[0][0][0]);
+    upper[1] = vld(&src[0][2][0]);
+    upper[2] = vld(&src[1][1][0]);
+    lower[0] = vld(&src[2][0][0]);
+    lower[1] = vld(&src[2][2][0]);
+    lower[2] = vld(&src[3][1][0]);
+
+    lower2[0] = lower[0];
+    lower2[1] = lower[1];
+    lower2[2] = lower[2];
+
+    swizzle(upper[0], upper[1], upper[2]);
+    swizzle(lower[0], lower[1], lower[2]);
+    swizzle2(lower2[0], lower2[1], lower2[2]);
 }
 
-// (a0+a3, a1-a2)
-void decomp_gamma1_minus_impl(Spinor src,
-                              float32x4_t& res1, float32x4_t& res2,
-                              float32x4_t& res3)
+template <typename H, typename V>
+inline void store_halfspinor(H dst[3][2][2], V v1, V v2, V v3)
 {
-    static uint32_t signs34UInt[4] __attribute__((aligned(16))) = {0x0, 0x0, 0x80000000, 0x80000000};
-    uint32x4_t signs34 = vld1q_u32(signs34UInt);
-    
-    float32x4_t vec1, vec2, vec3, vec4, vec5, vec6;
-    vec1 = vld1q_f32((float*)&src[0][0][0]);
-    vec2 = vld1q_f32((float*)&src[0][2][0]);
-    vec3 = vld1q_f32((float*)&src[1][1][0]);
-    vec4 = vld1q_f32((float*)&src[2][0][0]);
-    vec5 = vld1q_f32((float*)&src[2][2][0]);
-    vec6 = vld1q_f32((float*)&src[3][1][0]);
-
-    swizzle(vec1, vec2, vec3);
-    swizzle2(vec4, vec5, vec6);
-
-    change_sign(vec4, vec5, vec6, signs34);
-
-    res1 = vaddq_f32(vec1, vec4);
-    res2 = vaddq_f32(vec2, vec5);
-    res3 = vaddq_f32(vec3, vec6);
+    vst_hs(&dst[0][0][0], v1);
+    vst_hs(&dst[1][0][0], v2);
+    vst_hs(&dst[2][0][0], v3);
 }
 
-// (a0-i*a2, a1+i*a3)
-void decomp_gamma2_minus_impl(Spinor src,
-                              float32x4_t& res1, float32x4_t& res2,
-                              float32x4_t& res3)
+// the two spin projections of a direction are upper + t and upper - t.
+// dst <- upper + t
+// hdst <- adj(mat) * (upper - t)
+template <typename T>
+inline void decomp_add_hvv_sub(vreal4<T> const upper[3], vreal4<T> const t[3],
+                               GaugeMatT<T> const mat, HalfSpinorT<T> dst, HalfSpinorT<T> hdst)
 {
-    static uint32_t signs23UInt[4] __attribute__((aligned(16))) = {0x0, 0x80000000, 0x80000000, 0x0};
-    uint32x4_t signs23 = vld1q_u32(signs23UInt);
-    
-    float32x4_t vec1, vec2, vec3, vec4, vec5, vec6;
-    vec1 = vld1q_f32((float*)&src[0][0][0]);
-    vec2 = vld1q_f32((float*)&src[0][2][0]);
-    vec3 = vld1q_f32((float*)&src[1][1][0]);
-    vec4 = vld1q_f32((float*)&src[2][0][0]);
-    vec5 = vld1q_f32((float*)&src[2][2][0]);
-    vec6 = vld1q_f32((float*)&src[3][1][0]);
-
-    swizzle(vec1, vec2, vec3);
-    swizzle(vec4, vec5, vec6);
-
-    reverse_real_img(vec4, vec5, vec6);
-
-    change_sign(vec4, vec5, vec6, signs23);
-
-    res1 = vaddq_f32(vec1, vec4);
-    res2 = vaddq_f32(vec2, vec5);
-    res3 = vaddq_f32(vec3, vec6);
+    store_halfspinor(dst,
+                     vadd(upper[0], t[0]),
+                     vadd(upper[1], t[1]),
+                     vadd(upper[2], t[2]));
+
+    vreal4<T> v1 = vsub(upper[0], t[0]);
+    vreal4<T> v2 = vsub(upper[1], t[1]);
+    vreal4<T> v3 = vsub(upper[2], t[2]);
+    mat_hvv(v1, v2, v3, mat);
+    store_halfspinor(hdst, v1, v2, v3);
 }
 
-// (a0-a2, a1-a3)
-void decomp_gamma3_minus_impl(Spinor src,
-                              float32x4_t& res1, float32x4_t& res2,
-                              float32x4_t& res3)
-{   
-    float32x4_t vec1, vec2, vec3, vec4, vec5, vec6;
-    vec1 = vld1q_f32((float*)&src[0][0][0]);
-    vec2 = vld1q_f32((float*)&src[0][2][0]);
-    vec3 = vld1q_f32((float*)&src[1][1][0]);
-    vec4 = vld1q_f32((float*)&src[2][0][0]);
-    vec5 = vld1q_f32((float*)&src[2][2][0]);
-    vec6 = vld1q_f32((float*)&src[3][1][0]);
-
-    swizzle(vec1, vec2, vec3);
-    swizzle(vec4, vec5, vec6);
-
-    // no need to change signs. do subtract for all
-    res1 = vsubq_f32(vec1, vec4);
-    res2 = vsubq_f32(vec2, vec5);
-    res3 = vsubq_f32(vec3, vec6);
-}
-
-// (a0+i*a3, a1+i*a2)
-void decomp_gamma0_plus_impl(Spinor src,
-                             float32x4_t& res1, float32x4_t& res2,
-                             float32x4_t& res3)
+// dst <- upper - t
+// hdst <- adj(mat) * (upper + t)
+template <typename T>
+inline void decomp_sub_hvv_add(vreal4<T> const upper[3], vreal4<T> const t[3],
+                               GaugeMatT<T> const mat, HalfSpinorT<T> dst, HalfSpinorT<T> hdst)
 {
-    static uint32_t signs13UInt[4] __attribute__((aligned(16))) = {0x80000000, 0x0, 0x80000000, 0x0};
-    uint32x4_t signs13 = vld1q_u32(signs13UInt);
-    
-    float32x4_t vec1, vec2, vec3, vec4, vec5, vec6;
-    vec1 = vld1q_f32((float*)&src[0][0][0]);
-    vec2 = vld1q_f32((float*)&src[0][2][0]);
-    vec3 = vld1q_f32((float*)&src[1][1][0]);
-    vec4 = vld1q_f32((float*)&src[2][0][0]);
-    vec5 = vld1q_f32((float*)&src[2][2][0]);
-    vec6 = vld1q_f32((float*)&src[3][1][0]);
-
-    swizzle(vec1, vec2, vec3);
-    swizzle2(vec4, vec5, vec6);
-
-    reverse_real_img(vec4, vec5, vec6);
-
-    change_sign(vec4, vec5, vec6, signs13);
-
-    res1 = vaddq_f32(vec1, vec4);
-    res2 = vaddq_f32(vec2, vec5);
-    res3 = vaddq_f32(vec3, vec6);
+    store_halfspinor(dst,
+                     vsub(upper[0], t[0]),
+                     vsub(upper[1], t[1]),
+                     vsub(upper[2], t[2]));
+
+    vreal4<T> v1 = vadd(upper[0], t[0]);
+    vreal4<T> v2 = vadd(upper[1], t[1]);
+    vreal4<T> v3 = vadd(upper[2], t[2]);
+    mat_hvv(v1, v2, v3, mat);
+    store_halfspinor(hdst, v1, v2, v3);
 }
 
-// (a0-a3, a1+a2)
-void decomp_gamma1_plus_impl(Spinor src, 
-                             float32x4_t& res1, float32x4_t& res2,
-                             float32x4_t& res3)
+// dir0: t = (-i*a3, -i*a2)
+template <typename T>
+inline void decomp_term_gamma0(vreal4<T> const lower2[3], vreal4<T> t[3])
 {
-    static uint32_t signs12UInt[4] = {0x80000000, 0x80000000, 0x0, 0x0};
-    uint32x4_t signs12 = vld1q_u32(signs12UInt);
-
-    float32x4_t vec1, vec2, vec3, vec4, vec5, vec6;
-    vec1 = vld1q_f32((float*)&src[0][0][0]);
-    vec2 = vld1q_f32((float*)&src[0][2][0]);
-    vec3 = vld1q_f32((float*)&src[1][1][0]);
-    vec4 = vld1q_f32((float*)&src[2][0][0]);
-    vec5 = vld1q_f32((float*)&src[2][2][0]);
-    vec6 = vld1q_f32((float*)&src[3][1][0]);
-
-    swizzle(vec1, vec2, vec3);
-    swizzle2(vec4, vec5, vec6);
-
-    change_sign(vec4, vec5, vec6, signs12);
-
-    res1 = vaddq_f32(vec1, vec4);
-    res2 = vaddq_f32(vec2, vec5);
-    res3 = vaddq_f32(vec3, vec6);
+    static const SignBits<T> signs24Bits[4] __attribute__((aligned(32))) = {0, signBit<T>(), 0, signBit<T>()};
+    auto signs24 = vld_mask(signs24Bits);
+
+    t[0] = lower2[0];
+    t[1] = lower2[1];
+    t[2] = lower2[2];
+    reverse_real_img(t[0], t[1], t[2]);
+    change_sign(t[0], t[1], t[2], signs24);
 }
 
-// (a0+i*a2, a1-i*a3)
-void decomp_gamma2_plus_impl(Spinor src, 
-                             float32x4_t& res1, float32x4_t& res2,
-                             float32x4_t& res3)
+// dir1: t = (a3, -a2)
+template <typename T>
+inline void decomp_term_gamma1(vreal4<T> const lower2[3], vreal4<T> t[3])
 {
-    static uint32_t signs14UInt[4] = {0x80000000, 0x0, 0x0, 0x80000000};
-    uint32x4_t signs14 = vld1q_u32(signs14UInt);
-
-    float32x4_t vec1, vec2, vec3, vec4, vec5, vec6;
-    vec1 = vld1q_f32((float*)&src[0][0][0]);
-    vec2 = vld1q_f32((float*)&src[0][2][0]);
-    vec3 = vld1q_f32((float*)&src[1][1][0]);
-    vec4 = vld1q_f32((float*)&src[2][0][0]);
-    vec5 = vld1q_f32((float*)&src[2][2][0]);
-    vec6 = vld1q_f32((float*)&src[3][1][0]);
-
-    swizzle(vec1, vec2, vec3);
-    swizzle(vec4, vec5, vec6);
+    static const SignBits<T> signs34Bits[4] __attribute__((aligned(32))) = {0, 0, signBit<T>(), signBit<T>()};
+    auto signs34 = vld_mask(signs34Bits);
 
-    reverse_real_img(vec4, vec5, vec6);
-
-    change_sign(vec4, vec5, vec6, signs14);
-
-    res1 = vaddq_f32(vec1, vec4);
-    res2 = vaddq_f32(vec2, vec5);
-    res3 = vaddq_f32(vec3, vec6);
+    t[0] = lower2[0];
+    t[1] = lower2[1];
+    t[2] = lower2[2];
+    change_sign(t[0], t[1], t[2], signs34);
 }
 
-// (a0+a2, a1+a3)
-void decomp_gamma3_plus_impl(Spinor src, 
-                             float32x4_t& res1, float32x4_t& res2,
-                             float32x4_t& res3)
+// dir2: t = (-i*a2, i*a3)
+template <typename T>
+inline void decomp_term_gamma2(vreal4<T> const lower[3], vreal4<T> t[3])
 {
-    float32x4_t vec1, vec2, vec3, vec4, vec5, vec6;
-    vec1 = vld1q_f32((float*)&src[0][0][0]);
-    vec2 = vld1q_f32((float*)&src[0][2][0]);
-    vec3 = vld1q_f32((float*)&src[1][1][0]);
-    vec4 = vld1q_f32((float*)&src[2][0][0]);
-    vec5 = vld1q_f32((float*)&src[2][2][0]);
-    vec6 = vld1q_f32((float*)&src[3][1][0]);
-
-    swizzle(vec1, vec2, vec3);
-    swizzle(vec4, vec5, vec6);
-
-    res1 = vaddq_f32(vec1, vec4);
-    res2 = vaddq_f32(vec2, vec5);
-    res3 = vaddq_f32(vec3, vec6);
+    static const SignBits<T> signs23Bits[4] __attribute__((aligned(32))) = {0, signBit<T>(), signBit<T>(), 0};
+    auto signs23 = vld_mask(signs23Bits);
+
+    t[0] = lower[0];
+    t[1] = lower[1];
+    t[2] = lower[2];
+    reverse_real_img(t[0], t[1], t[2]);
+    change_sign(t[0], t[1], t[2], signs23);
 }
 
-// spinprojdirminus
-inline void decomp_gamma0_minus(Spinor src, HalfSpinor dst)
+// one load of src for both decomp phases of isign = +1
+// dst1..4 <- spinprojdirminus (chi1)
+// hdst1..4 <- adj(u) * spinprojdirplus (chi2)
+template <typename T>
+void decomp_hvv_4dir_plus(SpinorT<T> src,
+                          GaugeMatT<T> const mat1, GaugeMatT<T> const mat2,
+                          GaugeMatT<T> const mat3, GaugeMatT<T> const mat4,
+                          HalfSpinorT<T> dst1, HalfSpinorT<T> dst2, HalfSpinorT<T> dst3, HalfSpinorT<T> dst4,
+                          HalfSpinorT<T> hdst1, HalfSpinorT<T> hdst2, HalfSpinorT<T> hdst3, HalfSpinorT<T> hdst4)
 {
-    float32x4_t vec1, vec2, vec3;
-    decomp_gamma0_minus_impl(src, vec1, vec2, vec3);
+    vreal4<T> upper[3], lower[3], lower2[3];
+    load_swizzled(src, upper, lower, lower2);
 
-    vst1q_f32((float*)&dst[0][0][0], vec1);
-    vst1q_f32((float*)&dst[1][0][0], vec2);
-    vst1q_f32((float*)&dst[2][0][0], vec3);
-}
+    vreal4<T> t[3];
 
-inline void decomp_gamma1_minus(Spinor src, HalfSpinor dst)
-{
-    float32x4_t vec1, vec2, vec3;
-    decomp_gamma1_minus_impl(src, vec1, vec2, vec3);
-    
-    vst1q_f32((float*)&dst[0][0][0], vec1);
-    vst1q_f32((float*)&dst[1][0][0], vec2);
-    vst1q_f32((float*)&dst[2][0][0], vec3);
-}
+    // (a0-i*a3, a1-i*a2) and (a0+i*a3, a1+i*a2)
+    decomp_term_gamma0<T>(lower2, t);
+    decomp_add_hvv_sub(upper, t, mat1, dst1, hdst1);
 
-inline void decomp_gamma2_minus(Spinor src, HalfSpinor dst)
-{
-    float32x4_t vec1, vec2, vec3;
-    decomp_gamma2_minus_impl(src, vec1, vec2, vec3);
-    
-    vst1q_f32((float*)&dst[0][0][0], vec1);
-    vst1q_f32((float*)&dst[1][0][0], vec2);
-    vst1q_f32((float*)&dst[2][0][0], vec3);
-}
+    // (a0+a3, a1-a2) and (a0-a3, a1+a2)
+    decomp_term_gamma1<T>(lower2, t);
+    decomp_add_hvv_sub(upper, t, mat2, dst2, hdst2);
 
-inline void decomp_gamma3_minus(Spinor src, HalfSpinor dst)
-{   
-    float32x4_t vec1, vec2, vec3;
-    decomp_gamma3_minus_impl(src, vec1, vec2, vec3);
+    // (a0-i*a2, a1+i*a3) and (a0+i*a2, a1-i*a3)
+    decomp_term_gamma2<T>(lower, t);
+    decomp_add_hvv_sub(upper, t, mat3, dst3, hdst3);
 
-    vst1q_f32((float*)&dst[0][0][0], vec1);
-    vst1q_f32((float*)&dst[1][0][0], vec2);
-    vst1q_f32((float*)&dst[2][0][0], vec3);
+    // (a0-a2, a1-a3) and (a0+a2, a1+a3)
+    decomp_sub_hvv_add(upper, lower, mat4, dst4, hdst4);
 }
 
-// spinprojdirplus
-inline void decomp_gamma0_plus(Spinor src, HalfSpinor dst)
+// one load of src for both decomp phases of isign = -1
+// dst1..4 <- spinprojdirplus (chi1)
+// hdst1..4 <- adj(u) * spinprojdirminus (chi2)
+template <typename T>
+void decomp_hvv_4dir_minus(SpinorT<T> src,
+                           GaugeMatT<T> const mat1, GaugeMatT<T> const mat2,
+                           GaugeMatT<T> const mat3, GaugeMatT<T> const mat4,
+                           HalfSpinorT<T> dst1, HalfSpinorT<T> dst2, HalfSpinorT<T> dst3, HalfSpinorT<T> dst4,
+                           HalfSpinorT<T> hdst1, HalfSpinorT<T> hdst2, HalfSpinorT<T> hdst3, HalfSpinorT<T> hdst4)
 {
-    float32x4_t vec1, vec2, vec3;
-    decomp_gamma0_plus_impl(src, vec1, vec2, vec3);
+    vreal4<T> upper[3], lower[3], lower2[3];
+    load_swizzled(src, upper, lower, lower2);
 
-    vst1q_f32((float*)&dst[0][0][0], vec1);
-    vst1q_f32((float*)&dst[1][0][0], vec2);
-    vst1q_f32((float*)&dst[2][0][0], vec3);
-}
-
-inline void decomp_gamma1_plus(Spinor src, HalfSpinor dst)
-{
-    float32x4_t vec1, vec2, vec3;
-    decomp_gamma1_plus_impl(src, vec1, vec2, vec3);
-
-    vst1q_f32((float*)&dst[0][0][0], vec1);
-    vst1q_f32((float*)&dst[1][0][0], vec2);
-    vst1q_f32((float*)&dst[2][0][0], vec3);
-}
-
-inline void decomp_gamma2_plus(Spinor src, HalfSpinor dst)
-{
-    float32x4_t vec1, vec2, vec3;
-    decomp_gamma2_plus_impl(src, vec1, vec2, vec3);
-
-    vst1q_f32((float*)&dst[0][0][0], vec1);
-    vst1q_f32((float*)&dst[1][0][0], vec2);
-    vst1q_f32((float*)&dst[2][0][0], vec3);
-}
-
-inline void decomp_gamma3_plus(Spinor src, HalfSpinor dst)
-{
-    float32x4_t vec1, vec2, vec3;
-    decomp_gamma3_plus_impl(src, vec1, vec2, vec3);    
-
-    vst1q_f32((float*)&dst[0][0][0], vec1);
-    vst1q_f32((float*)&dst[1][0][0], vec2);
-    vst1q_f32((float*)&dst[2][0][0], vec3);
-}
-
-// adj(u) * spinprojdirplus
-inline void decomp_hvv_gamma0_plus(Spinor src, GaugeMat mat, HalfSpinor dst)
-{
-    float32x4_t vec1, vec2, vec3;
-    decomp_gamma0_plus_impl(src, vec1, vec2, vec3);
-    // now the half spinor is in [vec1 vec2 vec3]
-    // begin mat hvv
-    mat_hvv(vec1, vec2, vec3, mat);
-
-    vst1q_f32((float*)&dst[0][0][0], vec1);
-    vst1q_f32((float*)&dst[1][0][0], vec2);
-    vst1q_f32((float*)&dst[2][0][0], vec3);
-}
-
-inline void decomp_hvv_gamma1_plus(Spinor src, GaugeMat mat, HalfSpinor dst)
-{
-    float32x4_t vec1, vec2, vec3;
-    decomp_gamma1_plus_impl(src, vec1, vec2, vec3);
-    
-    mat_hvv(vec1, vec2, vec3, mat);
+    vreal4<T> t[3];
 
-    vst1q_f32((float*)&dst[0][0][0], vec1);
-    vst1q_f32((float*)&dst[1][0][0], vec2);
-    vst1q_f32((float*)&dst[2][0][0], vec3);
-}
+    decomp_term_gamma0<T>(lower2, t);
+    decomp_sub_hvv_add(upper, t, mat1, dst1, hdst1);
 
-inline void decomp_hvv_gamma2_plus(Spinor src, GaugeMat mat, HalfSpinor dst)
-{
-    float32x4_t vec1, vec2, vec3;
-    decomp_gamma2_plus_impl(src, vec1, vec2, vec3);
-    mat_hvv(vec1, vec2, vec3, mat);
+    decomp_term_gamma1<T>(lower2, t);
+    decomp_sub_hvv_add(upper, t, mat2, dst2, hdst2);
 
-    vst1q_f32((float*)&dst[0][0][0], vec1);
-    vst1q_f32((float*)&dst[1][0][0], vec2);
-    vst1q_f32((float*)&dst[2][0][0], vec3);
-}
-
-inline void decomp_hvv_gamma3_plus(Spinor src, GaugeMat mat, HalfSpinor dst)
-{
-    float32x4_t vec1, vec2, vec3;
-    decomp_gamma3_plus_impl(src, vec1, vec2, vec3);    
-    mat_hvv(vec1, vec2, vec3, mat);
+    decomp_term_gamma2<T>(lower, t);
+    decomp_sub_hvv_add(upper, t, mat3, dst3, hdst3);
 
-    vst1q_f32((float*)&dst[0][0][0], vec1);
-    vst1q_f32((float*)&dst[1][0][0], vec2);
-    vst1q_f32((float*)&dst[2][0][0], vec3);
+    decomp_add_hvv_sub(upper, lower, mat4, dst4, hdst4);
 }
 
-
-// adj(u) * spinprojdirminus
-inline void decomp_hvv_gamma0_minus(Spinor src, GaugeMat mat, HalfSpinor dst)
+// one direction mu of the decomp of src: the projection decomp_hvv_4dir_plus
+// (Plus) or decomp_hvv_4dir_minus writes to chi1 or, with Hvv, the
+// adj(mat) * projection it writes to chi2. for the sweeps that gather from
+// the neighbours themselves. mat is not read without Hvv
+template <typename T, bool Plus, bool Hvv>
+inline void decomp_1dir(SpinorT<T> src, int mu, GaugeMatT<T> const mat, HalfSpinorT<T> dst)
 {
-    float32x4_t vec1, vec2, vec3;
-    decomp_gamma0_minus_impl(src, vec1, vec2, vec3);
-    mat_hvv(vec1, vec2, vec3, mat);
+    vreal4<T> upper[3], lower[3], lower2[3];
+    load_swizzled(src, upper, lower, lower2);
+
+    vreal4<T> t[3];
+    if (mu == 0) {
+        decomp_term_gamma0<T>(lower2, t);
+    } else if (mu == 1) {
+        decomp_term_gamma1<T>(lower2, t);
+    } else if (mu == 2) {
+        decomp_term_gamma2<T>(lower, t);
+    } else {
+        t[0] = lower[0];
+        t[1] = lower[1];
+        t[2] = lower[2];
+    }
 
-    vst1q_f32((float*)&dst[0][0][0], vec1);
-    vst1q_f32((float*)&dst[1][0][0], vec2);
-    vst1q_f32((float*)&dst[2][0][0], vec3);
+    // chi1 gets upper + t for Plus and mu < 3, chi2 the other projection
+    bool add = (Plus == (mu < 3)) != Hvv;
+    vreal4<T> v1 = add ? vadd(upper[0], t[0]) : vsub(upper[0], t[0]);
+    vreal4<T> v2 = add ? vadd(upper[1], t[1]) : vsub(upper[1], t[1]);
+    vreal4<T> v3 = add ? vadd(upper[2], t[2]) : vsub(upper[2], t[2]);
+    if (Hvv) {
+        mat_hvv(v1, v2, v3, mat);
+    }
+    store_halfspinor(dst, v1, v2, v3);
 }
 
-inline void decomp_hvv_gamma1_minus(Spinor src, GaugeMat mat, HalfSpinor dst)
+template <typename T>
+inline void load_spinor_sums(SpinorT<T> src, vreal4<T> upperSum[3], vreal4<T> lowerSum[3])
 {
-    float32x4_t vec1, vec2, vec3;
-    decomp_gamma1_minus_impl(src, vec1, vec2, vec3);
-    mat_hvv(vec1, vec2, vec3, mat);
-    
-    vst1q_f32((float*)&dst[0][0][0], vec1);
-    vst1q_f32((float*)&dst[1][0][0], vec2);
-    vst1q_f32((float*)&dst[2][0][0], vec3);
+    upperSum[0] = vld(&src[0][0][0]);
+    upperSum[1] = vld(&src[0][2][0]);
+    upperSum[2] = vld(&src[1][1][0]);
+    lowerSum[0] = vld(&src[2][0][0]);
+    lowerSum[1] = vld(&src[2][2][0]);
+    lowerSum[2] = vld(&src[3][1][0]);
 }
 
-inline void decomp_hvv_gamma2_minus(Spinor src, GaugeMat mat, HalfSpinor dst)
+template <typename T>
+inline void store_spinor_sums(SpinorT<T> dst, vreal4<T> upperSum[3], vreal4<T> lowerSum[3])
 {
-    float32x4_t vec1, vec2, vec3;
-    decomp_gamma2_minus_impl(src, vec1, vec2, vec3);
-    mat_hvv(vec1, vec2, vec3, mat);
-    
-    vst1q_f32((float*)&dst[0][0][0], vec1);
-    vst1q_f32((float*)&dst[1][0][0], vec2);
-    vst1q_f32((float*)&dst[2][0][0], vec3);
+    vst(&dst[0][0][0], upperSum[0]);
+    vst(&dst[0][2][0], upperSum[1]);
+    vst(&dst[1][1][0], upperSum[2]);
+    vst(&dst[2][0][0], lowerSum[0]);
+    vst(&dst[2][2][0], lowerSum[1]);
+    vst(&dst[3][1][0], lowerSum[2]);
 }
 
-inline void decomp_hvv_gamma3_minus(Spinor src, GaugeMat mat, HalfSpinor dst)
-{   
-    float32x4_t vec1, vec2, vec3;
-    decomp_gamma3_minus_impl(src, vec1, vec2, vec3);
-    mat_hvv(vec1, vec2, vec3, mat);
-
-    vst1q_f32((float*)&dst[0][0][0], vec1);
-    vst1q_f32((float*)&dst[1][0][0], vec2);
-    vst1q_f32((float*)&dst[2][0][0], vec3);
-}
-
-void mvv_recons_4dir_minus(HalfSpinor src1, HalfSpinor src2, HalfSpinor src3, HalfSpinor src4,
-                           GaugeMat mat1, GaugeMat mat2, GaugeMat mat3, GaugeMat mat4,
-                           Spinor dst)
+// U * halfspinor of 4 directions reconstructed into a fresh partial sum
+template <typename T>
+void mvv_recons_4dir_minus_sum(HalfSpinorT<T> src1, HalfSpinorT<T> src2, HalfSpinorT<T> src3, HalfSpinorT<T> src4,
+                               GaugeMatT<T> const mat1, GaugeMatT<T> const mat2,
+                               GaugeMatT<T> const mat3, GaugeMatT<T> const mat4,
+                               vreal4<T> upperSum[3], vreal4<T> lowerSum[3])
 {
-    static uint32_t signs13UInt[4] __attribute__((aligned(16))) = {0x80000000, 0x0, 0x80000000, 0x0};
-    static uint32_t signs12UInt[4] __attribute__((aligned(16))) = {0x80000000, 0x80000000, 0x0, 0x0};
-    static uint32_t signs14UInt[4] __attribute__((aligned(16))) = {0x80000000, 0x0, 0x0, 0x80000000};
-    
-    
-    float32x4_t upperSum[3];
-    float32x4_t lowerSum[3];
+    static const SignBits<T> signs13Bits[4] __attribute__((aligned(32))) = {signBit<T>(), 0, signBit<T>(), 0};
+    static const SignBits<T> signs12Bits[4] __attribute__((aligned(32))) = {signBit<T>(), signBit<T>(), 0, 0};
+    static const SignBits<T> signs14Bits[4] __attribute__((aligned(32))) = {signBit<T>(), 0, 0, signBit<T>()};
 
     // dir0 (a0 a1) -> (a0 a1 i*a1 i*a0)
     {
-        uint32x4_t signs13 = vld1q_u32(signs13UInt);
+        auto signs13 = vld_mask(signs13Bits);
         
-        float32x4_t v1 = vld1q_f32((float*)&src1[0][0][0]);
-        float32x4_t v2 = vld1q_f32((float*)&src1[1][0][0]);
-        float32x4_t v3 = vld1q_f32((float*)&src1[2][0][0]);
+        vreal4<T> v1 = vld_hs(&src1[0][0][0]);
+        vreal4<T> v2 = vld_hs(&src1[1][0][0]);
+        vreal4<T> v3 = vld_hs(&src1[2][0][0]);
 
         mat_mvv(v1, v2, v3, mat1); // result in v1 v2 v3    
         // save upper half (a0 a1)
@@ -653,98 +534,88 @@ void mvv_recons_4dir_minus(HalfSpinor src1, HalfSpinor src2, HalfSpinor src3, Ha
 
     // dir1 (a0 a1) -> (a0 a1 -a1 a0)
     {
-        uint32x4_t signs12 = vld1q_u32(signs12UInt);
+        auto signs12 = vld_mask(signs12Bits);
         
-        float32x4_t v1 = vld1q_f32((float*)&src2[0][0][0]);
-        float32x4_t v2 = vld1q_f32((float*)&src2[1][0][0]);
-        float32x4_t v3 = vld1q_f32((float*)&src2[2][0][0]);
+        vreal4<T> v1 = vld_hs(&src2[0][0][0]);
+        vreal4<T> v2 = vld_hs(&src2[1][0][0]);
+        vreal4<T> v3 = vld_hs(&src2[2][0][0]);
         
         mat_mvv(v1, v2, v3, mat2);
 
-        upperSum[0] = vaddq_f32(upperSum[0], v1);
-        upperSum[1] = vaddq_f32(upperSum[1], v2);
-        upperSum[2] = vaddq_f32(upperSum[2], v3);
+        upperSum[0] = vadd(upperSum[0], v1);
+        upperSum[1] = vadd(upperSum[1], v2);
+        upperSum[2] = vadd(upperSum[2], v3);
         
-        v1 = vextq_f32(v1, v1, 2);
-        v2 = vextq_f32(v2, v2, 2);
-        v3 = vextq_f32(v3, v3, 2);
+        v1 = vext2(v1, v1);
+        v2 = vext2(v2, v2);
+        v3 = vext2(v3, v3);
 
         change_sign(v1, v2, v3, signs12);
 
-        lowerSum[0] = vaddq_f32(lowerSum[0], v1);
-        lowerSum[1] = vaddq_f32(lowerSum[1], v2);
-        lowerSum[2] = vaddq_f32(lowerSum[2], v3);
+        lowerSum[0] = vadd(lowerSum[0], v1);
+        lowerSum[1] = vadd(lowerSum[1], v2);
+        lowerSum[2] = vadd(lowerSum[2], v3);
     }
 
     // dir2 (a0 a1) -> (a0 a1 i*a0 -i*a1)
     {
-        uint32x4_t signs14 = vld1q_u32(signs14UInt);
-        float32x4_t v1 = vld1q_f32((float*)&src3[0][0][0]);
-        float32x4_t v2 = vld1q_f32((float*)&src3[1][0][0]);
-        float32x4_t v3 = vld1q_f32((float*)&src3[2][0][0]);
+        auto signs14 = vld_mask(signs14Bits);
+        vreal4<T> v1 = vld_hs(&src3[0][0][0]);
+        vreal4<T> v2 = vld_hs(&src3[1][0][0]);
+        vreal4<T> v3 = vld_hs(&src3[2][0][0]);
         
         mat_mvv(v1, v2, v3, mat3);
 
-        upperSum[0] = vaddq_f32(upperSum[0], v1);
-        upperSum[1] = vaddq_f32(upperSum[1], v2);
-        upperSum[2] = vaddq_f32(upperSum[2], v3);
+        upperSum[0] = vadd(upperSum[0], v1);
+        upperSum[1] = vadd(upperSum[1], v2);
+        upperSum[2] = vadd(upperSum[2], v3);
 
         reverse_real_img(v1, v2, v3);
         change_sign(v1, v2, v3, signs14);
 
-        lowerSum[0] = vaddq_f32(lowerSum[0], v1);
-        lowerSum[1] = vaddq_f32(lowerSum[1], v2);
-        lowerSum[2] = vaddq_f32(lowerSum[2], v3);
+        lowerSum[0] = vadd(lowerSum[0], v1);
+        lowerSum[1] = vadd(lowerSum[1], v2);
+        lowerSum[2] = vadd(lowerSum[2], v3);
     }
 
     // dir3 (a0 a1) -> (a0 a1 -a0 -a1)
     {
-        float32x4_t v1 = vld1q_f32((float*)&src4[0][0][0]);
-        float32x4_t v2 = vld1q_f32((float*)&src4[1][0][0]);
-        float32x4_t v3 = vld1q_f32((float*)&src4[2][0][0]);
+        vreal4<T> v1 = vld_hs(&src4[0][0][0]);
+        vreal4<T> v2 = vld_hs(&src4[1][0][0]);
+        vreal4<T> v3 = vld_hs(&src4[2][0][0]);
         
         mat_mvv(v1, v2, v3, mat4);
 
-        upperSum[0] = vaddq_f32(upperSum[0], v1);
-        upperSum[1] = vaddq_f32(upperSum[1], v2);
-        upperSum[2] = vaddq_f32(upperSum[2], v3);
+        upperSum[0] = vadd(upperSum[0], v1);
+        upperSum[1] = vadd(upperSum[1], v2);
+        upperSum[2] = vadd(upperSum[2], v3);
 
-        lowerSum[0] = vsubq_f32(lowerSum[0], v1);
-        lowerSum[1] = vsubq_f32(lowerSum[1], v2);
-        lowerSum[2] = vsubq_f32(lowerSum[2], v3);
+        lowerSum[0] = vsub(lowerSum[0], v1);
+        lowerSum[1] = vsub(lowerSum[1], v2);
+        lowerSum[2] = vsub(lowerSum[2], v3);
     }
-
-    // finally do stores
-    // don't do desizzling because it's partial sum 
-    vst1q_f32((float*)&dst[0][0][0], upperSum[0]);
-    vst1q_f32((float*)&dst[0][2][0], upperSum[1]);
-    vst1q_f32((float*)&dst[1][1][0], upperSum[2]);
-    vst1q_f32((float*)&dst[2][0][0], lowerSum[0]);
-    vst1q_f32((float*)&dst[2][2][0], lowerSum[1]);
-    vst1q_f32((float*)&dst[3][1][0], lowerSum[2]);
 }
 
-void mvv_recons_4dir_plus(HalfSpinor src1, HalfSpinor src2, HalfSpinor src3, HalfSpinor src4,
-                          GaugeMat mat1, GaugeMat mat2, GaugeMat mat3, GaugeMat mat4,
-                          Spinor dst)
+template <typename T>
+void mvv_recons_4dir_plus_sum(HalfSpinorT<T> src1, HalfSpinorT<T> src2, HalfSpinorT<T> src3, HalfSpinorT<T> src4,
+                              GaugeMatT<T> const mat1, GaugeMatT<T> const mat2,
+                              GaugeMatT<T> const mat3, GaugeMatT<T> const mat4,
+                              vreal4<T> upperSum[3], vreal4<T> lowerSum[3])
 {
-    uint32_t signs24UInt[4] __attribute__((aligned(16))) = {0, 0x80000000, 0, 0x80000000};
-    uint32_t signs34UInt[4] __attribute__((aligned(16))) = {0, 0, 0x80000000, 0x80000000};
-    uint32_t signs23UInt[4] __attribute__((aligned(16))) = {0, 0x80000000, 0x80000000, 0};
+    const SignBits<T> signs24Bits[4] __attribute__((aligned(32))) = {0, signBit<T>(), 0, signBit<T>()};
+    const SignBits<T> signs34Bits[4] __attribute__((aligned(32))) = {0, 0, signBit<T>(), signBit<T>()};
+    const SignBits<T> signs23Bits[4] __attribute__((aligned(32))) = {0, signBit<T>(), signBit<T>(), 0};
 
-    uint32x4_t signs24 = vld1q_u32(signs24UInt);
-    uint32x4_t signs34 = vld1q_u32(signs34UInt);
-    uint32x4_t signs23 = vld1q_u32(signs23UInt);
-    
-    float32x4_t upperSum[3];
-    float32x4_t lowerSum[3];
+    auto signs24 = vld_mask(signs24Bits);
+    auto signs34 = vld_mask(signs34Bits);
+    auto signs23 = vld_mask(signs23Bits);
 
     // dir0 (a0 a1) -> (a0 a1 -i*a1 -i*a0)
     {
-        float32x4_t v1, v2, v3;
-        v1 = vld1q_f32((float*)&src1[0][0][0]);
-        v2 = vld1q_f32((float*)&src1[1][0][0]);
-        v3 = vld1q_f32((float*)&src1[2][0][0]);
+        vreal4<T> v1, v2, v3;
+        v1 = vld_hs(&src1[0][0][0]);
+        v2 = vld_hs(&src1[1][0][0]);
+        v3 = vld_hs(&src1[2][0][0]);
         mat_mvv(v1, v2, v3, mat1);
 
         upperSum[0] = v1;
@@ -761,277 +632,521 @@ void mvv_recons_4dir_plus(HalfSpinor src1, HalfSpinor src2, HalfSpinor src3, Hal
 
     // dir1 (a0 a1) -> (a0 a1 a1 -a0)
     {
-        auto v1 = vld1q_f32((float*)&src2[0][0][0]);
-        auto v2 = vld1q_f32((float*)&src2[1][0][0]);
-        auto v3 = vld1q_f32((float*)&src2[2][0][0]);
+        auto v1 = vld_hs(&src2[0][0][0]);
+        auto v2 = vld_hs(&src2[1][0][0]);
+        auto v3 = vld_hs(&src2[2][0][0]);
         mat_mvv(v1, v2, v3, mat2);
 
-        upperSum[0] = vaddq_f32(upperSum[0], v1);
-        upperSum[1] = vaddq_f32(upperSum[1], v2);
-        upperSum[2] = vaddq_f32(upperSum[2], v3);
+        upperSum[0] = vadd(upperSum[0], v1);
+        upperSum[1] = vadd(upperSum[1], v2);
+        upperSum[2] = vadd(upperSum[2], v3);
 
-        v1 = vextq_f32(v1, v1, 2);
-        v2 = vextq_f32(v2, v2, 2);
-        v3 = vextq_f32(v3, v3, 2);
+        v1 = vext2(v1, v1);
+        v2 = vext2(v2, v2);
+        v3 = vext2(v3, v3);
         change_sign(v1, v2, v3, signs34);
 
-        lowerSum[0] = vaddq_f32(lowerSum[0], v1);
-        lowerSum[1] = vaddq_f32(lowerSum[1], v2);
-        lowerSum[2] = vaddq_f32(lowerSum[2], v3);
+        lowerSum[0] = vadd(lowerSum[0], v1);
+        lowerSum[1] = vadd(lowerSum[1], v2);
+        lowerSum[2] = vadd(lowerSum[2], v3);
     }
 
     // dir2 (a0 a1) -> (a0 a1 -i*a0 i*a1)
     {
-        auto v1 = vld1q_f32((float*)&src3[0][0][0]);
-        auto v2 = vld1q_f32((float*)&src3[1][0][0]);
-        auto v3 = vld1q_f32((float*)&src3[2][0][0]);
+        auto v1 = vld_hs(&src3[0][0][0]);
+        auto v2 = vld_hs(&src3[1][0][0]);
+        auto v3 = vld_hs(&src3[2][0][0]);
         mat_mvv(v1, v2, v3, mat3);
 
-        upperSum[0] = vaddq_f32(upperSum[0], v1);
-        upperSum[1] = vaddq_f32(upperSum[1], v2);
-        upperSum[2] = vaddq_f32(upperSum[2], v3);
+        upperSum[0] = vadd(upperSum[0], v1);
+        upperSum[1] = vadd(upperSum[1], v2);
+        upperSum[2] = vadd(upperSum[2], v3);
 
         reverse_real_img(v1, v2, v3);
         change_sign(v1, v2, v3, signs23);
 
-        lowerSum[0] = vaddq_f32(lowerSum[0], v1);
-        lowerSum[1] = vaddq_f32(lowerSum[1], v2);
-        lowerSum[2] = vaddq_f32(lowerSum[2], v3);
+        lowerSum[0] = vadd(lowerSum[0], v1);
+        lowerSum[1] = vadd(lowerSum[1], v2);
+        lowerSum[2] = vadd(lowerSum[2], v3);
     }
 
     // dir3 (a0 a1) -> (a0 a1 a0 a1)
     {
-        auto v1 = vld1q_f32((float*)&src4[0][0][0]);
-        auto v2 = vld1q_f32((float*)&src4[1][0][0]);
-        auto v3 = vld1q_f32((float*)&src4[2][0][0]);
+        auto v1 = vld_hs(&src4[0][0][0]);
+        auto v2 = vld_hs(&src4[1][0][0]);
+        auto v3 = vld_hs(&src4[2][0][0]);
         mat_mvv(v1, v2, v3, mat4);
 
-        upperSum[0] = vaddq_f32(upperSum[0], v1);
-        upperSum[1] = vaddq_f32(upperSum[1], v2);
-        upperSum[2] = vaddq_f32(upperSum[2], v3);
+        upperSum[0] = vadd(upperSum[0], v1);
+        upperSum[1] = vadd(upperSum[1], v2);
+        upperSum[2] = vadd(upperSum[2], v3);
 
-        lowerSum[0] = vaddq_f32(lowerSum[0], v1);
-        lowerSum[1] = vaddq_f32(lowerSum[1], v2);
-        lowerSum[2] = vaddq_f32(lowerSum[2], v3);
+        lowerSum[0] = vadd(lowerSum[0], v1);
+        lowerSum[1] = vadd(lowerSum[1], v2);
+        lowerSum[2] = vadd(lowerSum[2], v3);
     }
-
-    // done. store
-    vst1q_f32((float*)&dst[0][0][0], upperSum[0]);
-    vst1q_f32((float*)&dst[0][2][0], upperSum[1]);
-    vst1q_f32((float*)&dst[1][1][0], upperSum[2]);
-    vst1q_f32((float*)&dst[2][0][0], lowerSum[0]);
-    vst1q_f32((float*)&dst[2][2][0], lowerSum[1]);
-    vst1q_f32((float*)&dst[3][1][0], lowerSum[2]);
 }
 
-void recons_4dir_plus(HalfSpinor src1, HalfSpinor src2,
-                      HalfSpinor src3, HalfSpinor src4,
-                      Spinor dst)
+// reconstruct 4 halfspinors and add them to the partial sum
+template <typename T>
+void recons_4dir_plus_sum(HalfSpinorT<T> src1, HalfSpinorT<T> src2,
+                          HalfSpinorT<T> src3, HalfSpinorT<T> src4,
+                          vreal4<T> upperSum[3], vreal4<T> lowerSum[3])
 {
-    uint32_t signs24UInt[4] __attribute__((aligned(16))) = {0, 0x80000000, 0, 0x80000000};
-    uint32_t signs34UInt[4] __attribute__((aligned(16))) = {0, 0, 0x80000000, 0x80000000};
-    uint32_t signs23UInt[4] __attribute__((aligned(16))) = {0, 0x80000000, 0x80000000, 0};
+    const SignBits<T> signs24Bits[4] __attribute__((aligned(32))) = {0, signBit<T>(), 0, signBit<T>()};
+    const SignBits<T> signs34Bits[4] __attribute__((aligned(32))) = {0, 0, signBit<T>(), signBit<T>()};
+    const SignBits<T> signs23Bits[4] __attribute__((aligned(32))) = {0, signBit<T>(), signBit<T>(), 0};
 
-    uint32x4_t signs24 = vld1q_u32(signs24UInt);
-    uint32x4_t signs34 = vld1q_u32(signs34UInt);
-    uint32x4_t signs23 = vld1q_u32(signs23UInt);
-    
-    float32x4_t upperSum[3];
-    float32x4_t lowerSum[3];
-
-    // read partial sum
-    upperSum[0] = vld1q_f32((float*)&dst[0][0][0]);
-    upperSum[1] = vld1q_f32((float*)&dst[0][2][0]);
-    upperSum[2] = vld1q_f32((float*)&dst[1][1][0]);
-    lowerSum[0] = vld1q_f32((float*)&dst[2][0][0]);
-    lowerSum[1] = vld1q_f32((float*)&dst[2][2][0]);
-    lowerSum[2] = vld1q_f32((float*)&dst[3][1][0]);
+    auto signs24 = vld_mask(signs24Bits);
+    auto signs34 = vld_mask(signs34Bits);
+    auto signs23 = vld_mask(signs23Bits);
 
     // dir0 (a0 a1) -> (a0 a1 -i*a1 -i*a0)
     {
-        auto v1 = vld1q_f32((float*)&src1[0][0][0]);
-        auto v2 = vld1q_f32((float*)&src1[1][0][0]);
-        auto v3 = vld1q_f32((float*)&src1[2][0][0]);
+        auto v1 = vld_hs(&src1[0][0][0]);
+        auto v2 = vld_hs(&src1[1][0][0]);
+        auto v3 = vld_hs(&src1[2][0][0]);
 
-        upperSum[0] = vaddq_f32(upperSum[0], v1);
-        upperSum[1] = vaddq_f32(upperSum[1], v2);
-        upperSum[2] = vaddq_f32(upperSum[2], v3);
+        upperSum[0] = vadd(upperSum[0], v1);
+        upperSum[1] = vadd(upperSum[1], v2);
+        upperSum[2] = vadd(upperSum[2], v3);
 
         reverse_elements(v1, v2, v3);
         change_sign(v1, v2, v3, signs24);
 
-        lowerSum[0] = vaddq_f32(lowerSum[0], v1);
-        lowerSum[1] = vaddq_f32(lowerSum[1], v2);
-        lowerSum[2] = vaddq_f32(lowerSum[2], v3);
+        lowerSum[0] = vadd(lowerSum[0], v1);
+        lowerSum[1] = vadd(lowerSum[1], v2);
+        lowerSum[2] = vadd(lowerSum[2], v3);
     }
 
     // dir1 (a0 a1) -> (a0 a1 a1 -a0)
     {
-        auto v1 = vld1q_f32((float*)&src2[0][0][0]);
-        auto v2 = vld1q_f32((float*)&src2[1][0][0]);
-        auto v3 = vld1q_f32((float*)&src2[2][0][0]);
+        auto v1 = vld_hs(&src2[0][0][0]);
+        auto v2 = vld_hs(&src2[1][0][0]);
+        auto v3 = vld_hs(&src2[2][0][0]);
 
-        upperSum[0] = vaddq_f32(upperSum[0], v1);
-        upperSum[1] = vaddq_f32(upperSum[1], v2);
-        upperSum[2] = vaddq_f32(upperSum[2], v3);
+        upperSum[0] = vadd(upperSum[0], v1);
+        upperSum[1] = vadd(upperSum[1], v2);
+        upperSum[2] = vadd(upperSum[2], v3);
 
-        v1 = vextq_f32(v1, v1, 2);
-        v2 = vextq_f32(v2, v2, 2);
-        v3 = vextq_f32(v3, v3, 2);
+        v1 = vext2(v1, v1);
+        v2 = vext2(v2, v2);
+        v3 = vext2(v3, v3);
         change_sign(v1, v2, v3, signs34);
 
-        lowerSum[0] = vaddq_f32(lowerSum[0], v1);
-        lowerSum[1] = vaddq_f32(lowerSum[1], v2);
-        lowerSum[2] = vaddq_f32(lowerSum[2], v3);
+        lowerSum[0] = vadd(lowerSum[0], v1);
+        lowerSum[1] = vadd(lowerSum[1], v2);
+        lowerSum[2] = vadd(lowerSum[2], v3);
     }
 
     // dir2 (a0 a1) -> (a0 a1 -i*a0 -i*a1)
     {
-        auto v1 = vld1q_f32((float*)&src3[0][0][0]);
-        auto v2 = vld1q_f32((float*)&src3[1][0][0]);
-        auto v3 = vld1q_f32((float*)&src3[2][0][0]);
+        auto v1 = vld_hs(&src3[0][0][0]);
+        auto v2 = vld_hs(&src3[1][0][0]);
+        auto v3 = vld_hs(&src3[2][0][0]);
 
-        upperSum[0] = vaddq_f32(upperSum[0], v1);
-        upperSum[1] = vaddq_f32(upperSum[1], v2);
-        upperSum[2] = vaddq_f32(upperSum[2], v3);
+        upperSum[0] = vadd(upperSum[0], v1);
+        upperSum[1] = vadd(upperSum[1], v2);
+        upperSum[2] = vadd(upperSum[2], v3);
 
         reverse_real_img(v1, v2, v3);
         change_sign(v1, v2, v3, signs23);
 
-        lowerSum[0] = vaddq_f32(lowerSum[0], v1);
-        lowerSum[1] = vaddq_f32(lowerSum[1], v2);
-        lowerSum[2] = vaddq_f32(lowerSum[2], v3);
+        lowerSum[0] = vadd(lowerSum[0], v1);
+        lowerSum[1] = vadd(lowerSum[1], v2);
+        lowerSum[2] = vadd(lowerSum[2], v3);
     }
 
     // dir3 (a0 a1) -> (a0 a1 a0 a1)
     {
-        auto v1 = vld1q_f32((float*)&src4[0][0][0]);
-        auto v2 = vld1q_f32((float*)&src4[1][0][0]);
-        auto v3 = vld1q_f32((float*)&src4[2][0][0]);
+        auto v1 = vld_hs(&src4[0][0][0]);
+        auto v2 = vld_hs(&src4[1][0][0]);
+        auto v3 = vld_hs(&src4[2][0][0]);
 
-        upperSum[0] = vaddq_f32(upperSum[0], v1);
-        upperSum[1] = vaddq_f32(upperSum[1], v2);
-        upperSum[2] = vaddq_f32(upperSum[2], v3);
+        upperSum[0] = vadd(upperSum[0], v1);
+        upperSum[1] = vadd(upperSum[1], v2);
+        upperSum[2] = vadd(upperSum[2], v3);
 
-        lowerSum[0] = vaddq_f32(lowerSum[0], v1);
-        lowerSum[1] = vaddq_f32(lowerSum[1], v2);
-        lowerSum[2] = vaddq_f32(lowerSum[2], v3);
+        lowerSum[0] = vadd(lowerSum[0], v1);
+        lowerSum[1] = vadd(lowerSum[1], v2);
+        lowerSum[2] = vadd(lowerSum[2], v3);
     }
-
-    // done. deswizzle and store
-    deswizzle(upperSum[0], upperSum[1], upperSum[2]);
-    deswizzle(lowerSum[0], lowerSum[1], lowerSum[2]);
-    
-    vst1q_f32((float*)&dst[0][0][0], upperSum[0]);
-    vst1q_f32((float*)&dst[0][2][0], upperSum[1]);
-    vst1q_f32((float*)&dst[1][1][0], upperSum[2]);
-    vst1q_f32((float*)&dst[2][0][0], lowerSum[0]);
-    vst1q_f32((float*)&dst[2][2][0], lowerSum[1]);
-    vst1q_f32((float*)&dst[3][1][0], lowerSum[2]);
 }
 
-void recons_4dir_minus(HalfSpinor src1, HalfSpinor src2,
-                       HalfSpinor src3, HalfSpinor src4, 
-                       Spinor dst)
+template <typename T>
+void recons_4dir_minus_sum(HalfSpinorT<T> src1, HalfSpinorT<T> src2,
+                           HalfSpinorT<T> src3, HalfSpinorT<T> src4,
+                           vreal4<T> upperSum[3], vreal4<T> lowerSum[3])
 {
-    static uint32_t signs13UInt[4] __attribute__((aligned(16))) = {0x80000000, 0x0, 0x80000000, 0x0};
-    static uint32_t signs12UInt[4] __attribute__((aligned(16))) = {0x80000000, 0x80000000, 0x0, 0x0};
-    static uint32_t signs14UInt[4] __attribute__((aligned(16))) = {0x80000000, 0x0, 0x0, 0x80000000};
-        
-    float32x4_t upperSum[3];
-    float32x4_t lowerSum[3];
-    upperSum[0] = vld1q_f32((float*)&dst[0][0][0]);
-    upperSum[1] = vld1q_f32((float*)&dst[0][2][0]);
-    upperSum[2] = vld1q_f32((float*)&dst[1][1][0]);
-    lowerSum[0] = vld1q_f32((float*)&dst[2][0][0]);
-    lowerSum[1] = vld1q_f32((float*)&dst[2][2][0]);
-    lowerSum[2] = vld1q_f32((float*)&dst[3][1][0]);
+    static const SignBits<T> signs13Bits[4] __attribute__((aligned(32))) = {signBit<T>(), 0, signBit<T>(), 0};
+    static const SignBits<T> signs12Bits[4] __attribute__((aligned(32))) = {signBit<T>(), signBit<T>(), 0, 0};
+    static const SignBits<T> signs14Bits[4] __attribute__((aligned(32))) = {signBit<T>(), 0, 0, signBit<T>()};
 
     // dir0 (a0 a1) -> (a0 a1 i*a1 i*a0)
     {
-        uint32x4_t signs13 = vld1q_u32(signs13UInt);        
-        float32x4_t v1 = vld1q_f32((float*)&src1[0][0][0]);
-        float32x4_t v2 = vld1q_f32((float*)&src1[1][0][0]);
-        float32x4_t v3 = vld1q_f32((float*)&src1[2][0][0]);
+        auto signs13 = vld_mask(signs13Bits);        
+        vreal4<T> v1 = vld_hs(&src1[0][0][0]);
+        vreal4<T> v2 = vld_hs(&src1[1][0][0]);
+        vreal4<T> v3 = vld_hs(&src1[2][0][0]);
 
         // save upper half (a0 a1)
-        upperSum[0] = vaddq_f32(upperSum[0], v1);
-        upperSum[1] = vaddq_f32(upperSum[1], v2);
-        upperSum[2] = vaddq_f32(upperSum[2], v3);
+        upperSum[0] = vadd(upperSum[0], v1);
+        upperSum[1] = vadd(upperSum[1], v2);
+        upperSum[2] = vadd(upperSum[2], v3);
         // do reconstruct
         reverse_elements(v1, v2, v3);
         change_sign(v1, v2, v3, signs13);
-        lowerSum[0] = vaddq_f32(lowerSum[0], v1);
-        lowerSum[1] = vaddq_f32(lowerSum[1], v2);
-        lowerSum[2] = vaddq_f32(lowerSum[2], v3);
+        lowerSum[0] = vadd(lowerSum[0], v1);
+        lowerSum[1] = vadd(lowerSum[1], v2);
+        lowerSum[2] = vadd(lowerSum[2], v3);
     }
 
     // dir1 (a0 a1) -> (a0 a1 -a1 -a0)
     {
-        uint32x4_t signs12 = vld1q_u32(signs12UInt);
+        auto signs12 = vld_mask(signs12Bits);
         
-        auto v1 = vld1q_f32((float*)&src2[0][0][0]);
-        auto v2 = vld1q_f32((float*)&src2[1][0][0]);
-        auto v3 = vld1q_f32((float*)&src2[2][0][0]);        
+        auto v1 = vld_hs(&src2[0][0][0]);
+        auto v2 = vld_hs(&src2[1][0][0]);
+        auto v3 = vld_hs(&src2[2][0][0]);        
 
-        upperSum[0] = vaddq_f32(upperSum[0], v1);
-        upperSum[1] = vaddq_f32(upperSum[1], v2);
-        upperSum[2] = vaddq_f32(upperSum[2], v3);
+        upperSum[0] = vadd(upperSum[0], v1);
+        upperSum[1] = vadd(upperSum[1], v2);
+        upperSum[2] = vadd(upperSum[2], v3);
         
-        v1 = vextq_f32(v1, v1, 2);
-        v2 = vextq_f32(v2, v2, 2);
-        v3 = vextq_f32(v3, v3, 2);
+        v1 = vext2(v1, v1);
+        v2 = vext2(v2, v2);
+        v3 = vext2(v3, v3);
 
         change_sign(v1, v2, v3, signs12);
 
-        lowerSum[0] = vaddq_f32(lowerSum[0], v1);
-        lowerSum[1] = vaddq_f32(lowerSum[1], v2);
-        lowerSum[2] = vaddq_f32(lowerSum[2], v3);
+        lowerSum[0] = vadd(lowerSum[0], v1);
+        lowerSum[1] = vadd(lowerSum[1], v2);
+        lowerSum[2] = vadd(lowerSum[2], v3);
     }
 
     // dir2 (a0 a1) -> (a0 a1 i*a0 -i*a1)
     {
-        uint32x4_t signs14 = vld1q_u32(signs14UInt);
-        auto v1 = vld1q_f32((float*)&src3[0][0][0]);
-        auto v2 = vld1q_f32((float*)&src3[1][0][0]);
-        auto v3 = vld1q_f32((float*)&src3[2][0][0]);
+        auto signs14 = vld_mask(signs14Bits);
+        auto v1 = vld_hs(&src3[0][0][0]);
+        auto v2 = vld_hs(&src3[1][0][0]);
+        auto v3 = vld_hs(&src3[2][0][0]);
 
-        upperSum[0] = vaddq_f32(upperSum[0], v1);
-        upperSum[1] = vaddq_f32(upperSum[1], v2);
-        upperSum[2] = vaddq_f32(upperSum[2], v3);
+        upperSum[0] = vadd(upperSum[0], v1);
+        upperSum[1] = vadd(upperSum[1], v2);
+        upperSum[2] = vadd(upperSum[2], v3);
 
         reverse_real_img(v1, v2, v3);
         change_sign(v1, v2, v3, signs14);
 
-        lowerSum[0] = vaddq_f32(lowerSum[0], v1);
-        lowerSum[1] = vaddq_f32(lowerSum[1], v2);
-        lowerSum[2] = vaddq_f32(lowerSum[2], v3);
+        lowerSum[0] = vadd(lowerSum[0], v1);
+        lowerSum[1] = vadd(lowerSum[1], v2);
+        lowerSum[2] = vadd(lowerSum[2], v3);
     }
 
     // dir3 (a0 a1) -> (a0 a1 -a0 -a1)
     {
-        auto v1 = vld1q_f32((float*)&src4[0][0][0]);
-        auto v2 = vld1q_f32((float*)&src4[1][0][0]);
-        auto v3 = vld1q_f32((float*)&src4[2][0][0]);
+        auto v1 = vld_hs(&src4[0][0][0]);
+        auto v2 = vld_hs(&src4[1][0][0]);
+        auto v3 = vld_hs(&src4[2][0][0]);
 
-        upperSum[0] = vaddq_f32(upperSum[0], v1);
-        upperSum[1] = vaddq_f32(upperSum[1], v2);
-        upperSum[2] = vaddq_f32(upperSum[2], v3);
+        upperSum[0] = vadd(upperSum[0], v1);
+        upperSum[1] = vadd(upperSum[1], v2);
+        upperSum[2] = vadd(upperSum[2], v3);
 
-        lowerSum[0] = vsubq_f32(lowerSum[0], v1);
-        lowerSum[1] = vsubq_f32(lowerSum[1], v2);
-        lowerSum[2] = vsubq_f32(lowerSum[2], v3);
+        lowerSum[0] = vsub(lowerSum[0], v1);
+        lowerSum[1] = vsub(lowerSum[1], v2);
+        lowerSum[2] = vsub(lowerSum[2], v3);
     }
+}
+
+// the partial sum is stored as it is. don't do deswizzling
+template <typename T>
+void mvv_recons_4dir_minus(HalfSpinorT<T> src1, HalfSpinorT<T> src2, HalfSpinorT<T> src3, HalfSpinorT<T> src4,
+                           GaugeMatT<T> const mat1, GaugeMatT<T> const mat2,
+                           GaugeMatT<T> const mat3, GaugeMatT<T> const mat4,
+                           SpinorT<T> dst)
+{
+    vreal4<T> upperSum[3];
+    vreal4<T> lowerSum[3];
+
+    mvv_recons_4dir_minus_sum(src1, src2, src3, src4,
+                              mat1, mat2, mat3, mat4,
+                              upperSum, lowerSum);
+    store_spinor_sums(dst, upperSum, lowerSum);
+}
+
+template <typename T>
+void mvv_recons_4dir_plus(HalfSpinorT<T> src1, HalfSpinorT<T> src2, HalfSpinorT<T> src3, HalfSpinorT<T> src4,
+                          GaugeMatT<T> const mat1, GaugeMatT<T> const mat2,
+                          GaugeMatT<T> const mat3, GaugeMatT<T> const mat4,
+                          SpinorT<T> dst)
+{
+    vreal4<T> upperSum[3];
+    vreal4<T> lowerSum[3];
+
+    mvv_recons_4dir_plus_sum(src1, src2, src3, src4,
+                             mat1, mat2, mat3, mat4,
+                             upperSum, lowerSum);
+    store_spinor_sums(dst, upperSum, lowerSum);
+}
+
+// add to the partial sum in dst. deswizzle and store
+template <typename T>
+void recons_4dir_plus(HalfSpinorT<T> src1, HalfSpinorT<T> src2,
+                      HalfSpinorT<T> src3, HalfSpinorT<T> src4,
+                      SpinorT<T> dst)
+{
+    vreal4<T> upperSum[3];
+    vreal4<T> lowerSum[3];
+
+    load_spinor_sums(dst, upperSum, lowerSum);
+    recons_4dir_plus_sum<T>(src1, src2, src3, src4, upperSum, lowerSum);
 
     deswizzle(upperSum[0], upperSum[1], upperSum[2]);
     deswizzle(lowerSum[0], lowerSum[1], lowerSum[2]);
-    
-    vst1q_f32((float*)&dst[0][0][0], upperSum[0]);
-    vst1q_f32((float*)&dst[0][2][0], upperSum[1]);
-    vst1q_f32((float*)&dst[1][1][0], upperSum[2]);
-    vst1q_f32((float*)&dst[2][0][0], lowerSum[0]);
-    vst1q_f32((float*)&dst[2][2][0], lowerSum[1]);
-    vst1q_f32((float*)&dst[3][1][0], lowerSum[2]);
+    store_spinor_sums(dst, upperSum, lowerSum);
+}
+
+template <typename T>
+void recons_4dir_minus(HalfSpinorT<T> src1, HalfSpinorT<T> src2,
+                       HalfSpinorT<T> src3, HalfSpinorT<T> src4,
+                       SpinorT<T> dst)
+{
+    vreal4<T> upperSum[3];
+    vreal4<T> lowerSum[3];
+
+    load_spinor_sums(dst, upperSum, lowerSum);
+    recons_4dir_minus_sum<T>(src1, src2, src3, src4, upperSum, lowerSum);
+
+    deswizzle(upperSum[0], upperSum[1], upperSum[2]);
+    deswizzle(lowerSum[0], lowerSum[1], lowerSum[2]);
+    store_spinor_sums(dst, upperSum, lowerSum);
+}
+
+// mvv_recons_4dir_minus followed by recons_4dir_plus, summed in registers
+// and stored once. msrc: RECONS_MVV_GATHER, rsrc: RECONS_GATHER
+template <typename T>
+void recons_fused_8dir_plus(HalfSpinorT<T> msrc1, HalfSpinorT<T> msrc2, HalfSpinorT<T> msrc3, HalfSpinorT<T> msrc4,
+                            GaugeMatT<T> const mat1, GaugeMatT<T> const mat2,
+                            GaugeMatT<T> const mat3, GaugeMatT<T> const mat4,
+                            HalfSpinorT<T> rsrc1, HalfSpinorT<T> rsrc2, HalfSpinorT<T> rsrc3, HalfSpinorT<T> rsrc4,
+                            SpinorT<T> dst)
+{
+    vreal4<T> upperSum[3];
+    vreal4<T> lowerSum[3];
+
+    mvv_recons_4dir_minus_sum(msrc1, msrc2, msrc3, msrc4,
+                              mat1, mat2, mat3, mat4,
+                              upperSum, lowerSum);
+    recons_4dir_plus_sum<T>(rsrc1, rsrc2, rsrc3, rsrc4, upperSum, lowerSum);
+
+    deswizzle(upperSum[0], upperSum[1], upperSum[2]);
+    deswizzle(lowerSum[0], lowerSum[1], lowerSum[2]);
+    store_spinor_sums(dst, upperSum, lowerSum);
+}
+
+// mvv_recons_4dir_plus followed by recons_4dir_minus
+template <typename T>
+void recons_fused_8dir_minus(HalfSpinorT<T> msrc1, HalfSpinorT<T> msrc2, HalfSpinorT<T> msrc3, HalfSpinorT<T> msrc4,
+                             GaugeMatT<T> const mat1, GaugeMatT<T> const mat2,
+                             GaugeMatT<T> const mat3, GaugeMatT<T> const mat4,
+                             HalfSpinorT<T> rsrc1, HalfSpinorT<T> rsrc2, HalfSpinorT<T> rsrc3, HalfSpinorT<T> rsrc4,
+                             SpinorT<T> dst)
+{
+    vreal4<T> upperSum[3];
+    vreal4<T> lowerSum[3];
+
+    mvv_recons_4dir_plus_sum(msrc1, msrc2, msrc3, msrc4,
+                             mat1, mat2, mat3, mat4,
+                             upperSum, lowerSum);
+    recons_4dir_minus_sum<T>(rsrc1, rsrc2, rsrc3, rsrc4, upperSum, lowerSum);
+
+    deswizzle(upperSum[0], upperSum[1], upperSum[2]);
+    deswizzle(lowerSum[0], lowerSum[1], lowerSum[2]);
+    store_spinor_sums(dst, upperSum, lowerSum);
+}
+
+// dst = A dst with the packed clover term A. the result of the recons
+// kernels is still in L1, and a lane duplicated layout to vectorize this
+// would more than double the clover traffic
+template <typename T>
+void clover_apply(Chroma::PackedCloverT<T> const& clov, SpinorT<T> dst)
+{
+    for (int b = 0; b < 2; ++b) {
+        T (*psi)[2] = (T (*)[2]) dst[2*b];
+
+        T in[6][2];
+        for (int i = 0; i < 6; ++i) {
+            in[i][0] = psi[i][0];
+            in[i][1] = psi[i][1];
+            psi[i][0] = clov.diag[b][i] * in[i][0];
+            psi[i][1] = clov.diag[b][i] * in[i][1];
+        }
+
+        int ij = 0;
+        for (int i = 1; i < 6; ++i) {
+            for (int j = 0; j < i; ++j, ++ij) {
+                T ar = clov.offd[b][ij][0];
+                T ai = clov.offd[b][ij][1];
+
+                // A(i,j) in_j and conj(A(i,j)) in_i
+                psi[i][0] += ar * in[j][0] - ai * in[j][1];
+                psi[i][1] += ar * in[j][1] + ai * in[j][0];
+                psi[j][0] += ar * in[i][0] + ai * in[i][1];
+                psi[j][1] += ar * in[i][1] - ai * in[i][0];
+            }
+        }
+    }
+}
+
+// dst = a x + b dst
+template <typename T>
+inline void axpby_apply(T a, SpinorT<T> const x, T b, SpinorT<T> dst)
+{
+    T const* px = &x[0][0][0];
+    T* pd = &dst[0][0][0];
+    vreal4<T> va = vld_dup(&a);
+    vreal4<T> vb = vld_dup(&b);
+    for (int k = 0; k < 24; k += 4) {
+        vst(pd + k, vfma(vmul(vb, vld(pd + k)), va, vld(px + k)));
+    }
+}
+
+// sums += |dst|^2 and, with y, <y, dst>. in double, the fields are large
+template <typename T>
+inline void reduce_site(SpinorT<T> const dst, SpinorT<T> const* y, double sums[3])
+{
+    T const* pd = &dst[0][0][0];
+    double norm = 0;
+    for (int k = 0; k < 24; ++k) {
+        norm += (double)pd[k] * pd[k];
+    }
+    sums[0] += norm;
+
+    if (y != 0) {
+        T const* py = &(*y)[0][0][0];
+        double re = 0;
+        double im = 0;
+        for (int k = 0; k < 24; k += 2) {
+            re += (double)py[k] * pd[k] + (double)py[k + 1] * pd[k + 1];
+            im += (double)py[k] * pd[k + 1] - (double)py[k + 1] * pd[k];
+        }
+        sums[1] += re;
+        sums[2] += im;
+    }
+}
+
+// dst = (t[0] + i t[1] gamma5) dst, gamma5 = diag(1, 1, -1, -1) in the
+// DeGrand-Rossi basis
+template <typename T>
+inline void twist_apply(T const twist[2], SpinorT<T> dst)
+{
+    for (int s = 0; s < 4; ++s) {
+        T tr = twist[0];
+        T ti = s < 2 ? twist[1] : -twist[1];
+        for (int c = 0; c < 3; ++c) {
+            T re = dst[s][c][0];
+            T im = dst[s][c][1];
+            dst[s][c][0] = tr * re - ti * im;
+            dst[s][c][1] = tr * im + ti * re;
+        }
+    }
+}
+
+// dst = a (t[0] + i t[1] gamma5) x + b dst
+template <typename T>
+inline void axpby_twisted_apply(T a, T const twist[2], SpinorT<T> const x, T b,
+                                SpinorT<T> dst)
+{
+    for (int s = 0; s < 4; ++s) {
+        T tr = a * twist[0];
+        T ti = s < 2 ? a * twist[1] : -a * twist[1];
+        for (int c = 0; c < 3; ++c) {
+            T re = x[s][c][0];
+            T im = x[s][c][1];
+            dst[s][c][0] = tr * re - ti * im + b * dst[s][c][0];
+            dst[s][c][1] = tr * im + ti * re + b * dst[s][c][1];
+        }
+    }
+}
+
+// out_s = (c[0] + c[1] P) in_s over the N = Ls slices in_s = field[s][site]
+// of a site, see FifthDimT
+template <typename T, int N>
+inline void fifth_mix(SpinorT<T>* out, SpinorT<T>* const* field, int site,
+                      T const c[2], Chroma::FifthDimT<T> const& fifth)
+{
+    for (int s = 0; s < N; ++s) {
+        // the slices of the P_+ (upper spins) and P_- terms
+        int up = fifth.dagger ? s + 1 : s - 1;
+        int lo = fifth.dagger ? s - 1 : s + 1;
+        T cu = up < 0 || up >= N ? -fifth.mass*c[1] : c[1];
+        T cl = lo < 0 || lo >= N ? -fifth.mass*c[1] : c[1];
+
+        T const* pin = &field[s][site][0][0][0];
+        T const* pu = &field[(up + N) % N][site][0][0][0];
+        T const* pl = &field[(lo + N) % N][site][0][0][0];
+        T* po = &out[s][0][0][0];
+        for (int k = 0; k < 12; ++k) {
+            po[k] = c[0] * pin[k] + cu * pu[k];
+        }
+        for (int k = 12; k < 24; ++k) {
+            po[k] = c[0] * pin[k] + cl * pl[k];
+        }
+    }
+}
+
+// dst = src with non-temporal stores where the size and alignment allow
+template <typename P>
+inline void stream_store(P& dst, P const& src)
+{
+    if (sizeof(P) % 16 == 0 && ((uintptr_t)&dst & 15) == 0) {
+        stream_copy(&dst, &src, sizeof(P));
+    } else {
+        std::memcpy(&dst, &src, sizeof(P));
+    }
+}
+
+// the epilogue of the recons sweeps on the N sources of a finished site,
+// res[r] is the result of source r. sums: the partial sums of the thread
+// or null
+template <typename T, int N>
+inline void sweep_epilogue(Chroma::SweepEpilogueT<T> const& ep, int site,
+                           SpinorT<T>* const* res, double* sums)
+{
+    SpinorT<T> mixed[N];
+    Chroma::FifthDimT<T> const* fifth = ep.fifth;
+
+    if (fifth != 0 && fifth->dagger) {
+        fifth_mix<T, N>(mixed, res, 0, fifth->hop, *fifth);
+        for (int r = 0; r < N; ++r) {
+            std::memcpy(res[r], mixed[r], sizeof(SpinorT<T>));
+        }
+    }
+    if (fifth != 0 && ep.x != 0) {
+        fifth_mix<T, N>(mixed, ep.x, site, fifth->diag, *fifth);
+    }
+
+    for (int r = 0; r < N; ++r) {
+        SpinorT<T>& dst = *res[r];
+        if (ep.clover != 0) {
+            clover_apply(ep.clover[site], dst);
+        }
+        if (ep.twist != 0) {
+            twist_apply(ep.twist, dst);
+        }
+        if (ep.x != 0) {
+            SpinorT<T> const& x = fifth != 0 ? mixed[r] : ep.x[r][site];
+            if (ep.xTwist != 0) {
+                axpby_twisted_apply(ep.a, ep.xTwist, x, ep.b, dst);
+            } else {
+                axpby_apply(ep.a, x, ep.b, dst);
+            }
+        }
+        if (sums != 0) {
+            reduce_site<T>(dst, ep.y == 0 ? 0 : &ep.y[r][site], sums + 3*r);
+        }
+    }
 }
 
 } // namespace anonymous
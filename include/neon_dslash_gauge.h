@@ -0,0 +1,241 @@
+#ifndef NEON_DSLASH_GAUGE_H
+#define NEON_DSLASH_GAUGE_H
+
+// Compression of the packed gauge links into GaugeLink12 / GaugeLink8 and
+// the reconstruction the kernels do on the fly. A packed link holds
+// packed[n][m] = U(m,n), see NeonWilsonDslash::packGauge.
+//
+// U must be s * V with V in SU(3) and s real, which covers the anisotropy
+// coefficients and the sign flips of the fermion boundary conditions.
+// Links with a complex det(U), e.g. from a U(1) phase, are rejected. The 8
+// real form is singular where |V00| = 1, e.g. for a unit gauge, and such
+// links are rejected too; use the 12 real form for them.
+
+#include <cmath>
+#include <complex>
+#include <limits>
+
+#include "neon_dslash_types.h"
+#include "qmp.h"
+
+namespace Chroma
+{
+
+namespace GaugeDetail
+{
+template <typename T>
+struct Cplx
+{
+    T re;
+    T im;
+};
+
+template <typename T>
+inline Cplx<T> operator*(Cplx<T> x, Cplx<T> y)
+{
+    return Cplx<T>{x.re*y.re - x.im*y.im, x.re*y.im + x.im*y.re};
+}
+
+template <typename T>
+inline Cplx<T> operator+(Cplx<T> x, Cplx<T> y)
+{
+    return Cplx<T>{x.re + y.re, x.im + y.im};
+}
+
+template <typename T>
+inline Cplx<T> operator-(Cplx<T> x, Cplx<T> y)
+{
+    return Cplx<T>{x.re - y.re, x.im - y.im};
+}
+
+template <typename T>
+inline Cplx<T> operator*(T a, Cplx<T> x)
+{
+    return Cplx<T>{a*x.re, a*x.im};
+}
+
+template <typename T>
+inline Cplx<T> conj(Cplx<T> x)
+{
+    return Cplx<T>{x.re, -x.im};
+}
+
+template <typename T>
+inline T norm(Cplx<T> x)
+{
+    return x.re*x.re + x.im*x.im;
+}
+
+// U(m,n) of a packed link as a complex number
+template <typename T>
+inline std::complex<T> entry(GaugeMatT<T> const packed, int m, int n)
+{
+    return std::complex<T>(packed[n][m][0], packed[n][m][1]);
+}
+
+// relative tolerance of the checks in compressGauge
+template <typename T>
+inline T compressTolerance()
+{
+    return std::sqrt(std::numeric_limits<T>::epsilon());
+}
+
+// s with det(U) = s^3
+template <typename T>
+T linkScale(GaugeMatT<T> const packed)
+{
+    std::complex<T> det = 0;
+    for (int n = 0; n < 3; ++n) {
+        int j = (n + 1) % 3;
+        int k = (n + 2) % 3;
+        det += entry(packed, 0, n) *
+            (entry(packed, 1, j) * entry(packed, 2, k) - entry(packed, 1, k) * entry(packed, 2, j));
+    }
+    if (std::abs(det.imag()) > compressTolerance<T>() * std::abs(det)) {
+        QMP_error("compressGauge: det(U) = (%g, %g) is not real, the link carries a phase",
+                  double(det.real()), double(det.imag()));
+        QMP_abort(1);
+    }
+    return std::cbrt(det.real());
+}
+} // namespace GaugeDetail
+
+// no compression
+template <typename T>
+inline void compressGauge(GaugeMatT<T> const packed, GaugeMatT<T> out)
+{
+    for (int n = 0; n < 3; ++n) {
+        for (int m = 0; m < 3; ++m) {
+            out[n][m][0] = packed[n][m][0];
+            out[n][m][1] = packed[n][m][1];
+        }
+    }
+}
+
+template <typename T>
+void compressGauge(GaugeMatT<T> const packed, GaugeLink12<T>& out)
+{
+    for (int m = 0; m < 2; ++m) {
+        for (int n = 0; n < 3; ++n) {
+            out.rows[m][n][0] = packed[n][m][0];
+            out.rows[m][n][1] = packed[n][m][1];
+        }
+    }
+    out.invScale = 1 / GaugeDetail::linkScale<T>(packed);
+}
+
+template <typename T>
+void compressGauge(GaugeMatT<T> const packed, GaugeLink8<T>& out)
+{
+    using GaugeDetail::entry;
+
+    T s = GaugeDetail::linkScale<T>(packed);
+    std::complex<T> v01 = entry(packed, 0, 1) / s;
+    std::complex<T> v02 = entry(packed, 0, 2) / s;
+    std::complex<T> v10 = entry(packed, 1, 0) / s;
+
+    // reconstructGauge divides by |V01|^2 + |V02|^2 = 1 - |V00|^2
+    T rowSum = std::norm(v01) + std::norm(v02);
+    if (rowSum < GaugeDetail::compressTolerance<T>()) {
+        QMP_error("compressGauge: |V01|^2 + |V02|^2 = %g, the 8 real form cannot rebuild the link; "
+                  "use --enable-gauge-compression=12", double(rowSum));
+        QMP_abort(1);
+    }
+
+    out.v01[0] = v01.real();
+    out.v01[1] = v01.imag();
+    out.v02[0] = v02.real();
+    out.v02[1] = v02.imag();
+    out.v10[0] = v10.real();
+    out.v10[1] = v10.imag();
+    out.argV00 = std::arg(entry(packed, 0, 0) / s);
+    out.argV20 = std::arg(entry(packed, 2, 0) / s);
+    out.scale = s;
+}
+
+// third row = conj(row0 x row1) / s
+template <typename T>
+inline void reconstructGauge(GaugeLink12<T> const& link, GaugeMatT<T> mat)
+{
+    T const (*a)[2] = link.rows[0];
+    T const (*b)[2] = link.rows[1];
+
+    for (int n = 0; n < 3; ++n) {
+        int j = (n + 1) % 3;
+        int k = (n + 2) % 3;
+
+        // a_j b_k - a_k b_j
+        T re = a[j][0]*b[k][0] - a[j][1]*b[k][1] - a[k][0]*b[j][0] + a[k][1]*b[j][1];
+        T im = a[j][0]*b[k][1] + a[j][1]*b[k][0] - a[k][0]*b[j][1] - a[k][1]*b[j][0];
+
+        mat[n][0][0] = a[n][0];
+        mat[n][0][1] = a[n][1];
+        mat[n][1][0] = b[n][0];
+        mat[n][1][1] = b[n][1];
+        mat[n][2][0] = re * link.invScale;
+        mat[n][2][1] = -im * link.invScale;
+    }
+}
+
+// rows a, b, c of V. |a0| and |c0| follow from the unit norm of row a and
+// column 0, b1 b2 c1 c2 from the orthogonality of the rows and c = conj(a x b)
+template <typename T>
+inline void reconstructGauge(GaugeLink8<T> const& link, GaugeMatT<T> mat)
+{
+    using Cplx = GaugeDetail::Cplx<T>;
+    using GaugeDetail::conj;
+    using GaugeDetail::norm;
+
+    Cplx a1{link.v01[0], link.v01[1]};
+    Cplx a2{link.v02[0], link.v02[1]};
+    Cplx b0{link.v10[0], link.v10[1]};
+
+    T rowSum = norm(a1) + norm(a2);
+    T a0Abs = std::sqrt(std::fmax(T(1) - rowSum, T(0)));
+    T c0Abs = std::sqrt(std::fmax(rowSum - norm(b0), T(0)));
+    Cplx a0{a0Abs * std::cos(link.argV00), a0Abs * std::sin(link.argV00)};
+    Cplx c0{c0Abs * std::cos(link.argV20), c0Abs * std::sin(link.argV20)};
+
+    T r = 1 / rowSum;
+    Cplx a0b0 = conj(a0) * b0;
+    Cplx a0c0 = conj(a0) * c0;
+
+    Cplx b1 = (-r) * (a0b0 * a1 + conj(a2) * conj(c0));
+    Cplx b2 = r * (conj(a1) * conj(c0) - a2 * a0b0);
+    Cplx c1 = r * (conj(a2) * conj(b0) - a0c0 * a1);
+    Cplx c2 = (-r) * (conj(a1) * conj(b0) + a2 * a0c0);
+
+    Cplx v[3][3] = {{a0, a1, a2}, {b0, b1, b2}, {c0, c1, c2}};
+    for (int n = 0; n < 3; ++n) {
+        for (int m = 0; m < 3; ++m) {
+            mat[n][m][0] = link.scale * v[m][n].re;
+            mat[n][m][1] = link.scale * v[m][n].im;
+        }
+    }
+}
+
+// the full matrix of a packed link. compressed links are rebuilt into
+// scratch, uncompressed ones are used in place
+template <typename T>
+inline GaugeMatT<T> const& linkMatrix(GaugeMatT<T> const& link, GaugeMatT<T>& /* scratch */)
+{
+    return link;
+}
+
+template <typename T>
+inline GaugeMatT<T> const& linkMatrix(GaugeLink12<T> const& link, GaugeMatT<T>& scratch)
+{
+    reconstructGauge(link, scratch);
+    return scratch;
+}
+
+template <typename T>
+inline GaugeMatT<T> const& linkMatrix(GaugeLink8<T> const& link, GaugeMatT<T>& scratch)
+{
+    reconstructGauge(link, scratch);
+    return scratch;
+}
+
+} // namespace Chroma
+
+#endif // NEON_DSLASH_GAUGE_H
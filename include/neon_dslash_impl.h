@@ -1,8 +1,6 @@
 #ifndef NEON_DSLASH_IMPL_H
 #define NEON_DSLASH_IMPL_H
 
-#include <arm_neon.h>
-
 #include "shift_table.h"
 #include "dslash_table.h"
 #include "neon_dslash_types.h"
@@ -10,45 +8,101 @@
 namespace Chroma
 {
 
-void decomp_plus(int lo, int hi, int id,
-                 Spinor* spinorField, HalfSpinor* chi,
-                 GaugeMat (*gaugeField)[4], int cb,
-                 ShiftTable* sTab);
+// the sweeps apply to N sources at once, sp[r] is the field of source r.
+// they are instantiated for T = float and double, N = 1, 2, 4, 8, 12, 16,
+// 20 and 24.
+// the recons sweeps apply the epilogue ep (clover term, axpy) where they
+// finish a site, see SweepEpilogueT
 
-void decomp_hvv_plus(int lo, int hi, int id,
-                     Spinor* sp, HalfSpinor* chi,
-                     GaugeMat (*gauge)[4], int cb,
-                     ShiftTable* sTab);
+template <typename T, int N>
+void decomp_fused_plus(int lo, int hi, int id,
+                       SpinorT<T>* const* sp, HalfSpinorBlockT<T, N>* chi,
+                       PackedGaugeT<T> (*gauge)[4], int cb,
+                       ShiftTable<T, N>* sTab,
+                       SweepEpilogueT<T> const* ep);
 
+template <typename T, int N>
 void mvv_recons_plus(int lo, int hi, int id,
-                     Spinor* sp, HalfSpinor* chi,
-                     GaugeMat (*gauge)[4], int cb,
-                     ShiftTable* sTab);
+                     SpinorT<T>* const* sp, HalfSpinorBlockT<T, N>* chi,
+                     PackedGaugeT<T> (*gauge)[4], int cb,
+                     ShiftTable<T, N>* sTab,
+                     SweepEpilogueT<T> const* ep);
 
+template <typename T, int N>
 void recons_plus(int lo, int hi, int id,
-                 Spinor* sp, HalfSpinor* chi,
-                 GaugeMat (*gauge)[4], int cb,
-                 ShiftTable* sTab);
+                 SpinorT<T>* const* sp, HalfSpinorBlockT<T, N>* chi,
+                 PackedGaugeT<T> (*gauge)[4], int cb,
+                 ShiftTable<T, N>* sTab,
+                 SweepEpilogueT<T> const* ep);
 
-void decomp_minus(int lo, int hi, int id,
-                  Spinor* sp, HalfSpinor* chi,
-                  GaugeMat (*gauge)[4], int cb,
-                  ShiftTable* sTab);
+template <typename T, int N>
+void recons_fused_plus(int lo, int hi, int id,
+                       SpinorT<T>* const* sp, HalfSpinorBlockT<T, N>* chi,
+                       PackedGaugeT<T> (*gauge)[4], int cb,
+                       ShiftTable<T, N>* sTab,
+                       SweepEpilogueT<T> const* ep);
 
-void decomp_hvv_minus(int lo, int hi, int id,
-                      Spinor* sp, HalfSpinor* chi,
-                      GaugeMat (*gauge)[4], int cb,
-                      ShiftTable* sTab);
+template <typename T, int N>
+void decomp_fused_minus(int lo, int hi, int id,
+                        SpinorT<T>* const* sp, HalfSpinorBlockT<T, N>* chi,
+                        PackedGaugeT<T> (*gauge)[4], int cb,
+                        ShiftTable<T, N>* sTab,
+                        SweepEpilogueT<T> const* ep);
 
+template <typename T, int N>
 void mvv_recons_minus(int lo, int hi, int id,
-                      Spinor* sp, HalfSpinor* chi,
-                      GaugeMat (*gauge)[4], int cb,
-                      ShiftTable* sTab);
+                      SpinorT<T>* const* sp, HalfSpinorBlockT<T, N>* chi,
+                      PackedGaugeT<T> (*gauge)[4], int cb,
+                      ShiftTable<T, N>* sTab,
+                      SweepEpilogueT<T> const* ep);
 
+template <typename T, int N>
 void recons_minus(int lo, int hi, int id,
-                  Spinor* sp, HalfSpinor* chi,
-                  GaugeMat (*gauge)[4], int cb,
-                  ShiftTable* sTab);
+                  SpinorT<T>* const* sp, HalfSpinorBlockT<T, N>* chi,
+                  PackedGaugeT<T> (*gauge)[4], int cb,
+                  ShiftTable<T, N>* sTab,
+                  SweepEpilogueT<T> const* ep);
+
+template <typename T, int N>
+void recons_fused_minus(int lo, int hi, int id,
+                        SpinorT<T>* const* sp, HalfSpinorBlockT<T, N>* chi,
+                        PackedGaugeT<T> (*gauge)[4], int cb,
+                        ShiftTable<T, N>* sTab,
+                        SweepEpilogueT<T> const* ep);
+
+// GAUGE_DOUBLE_STORED: the decomp of the face sites [lo, hi) as ordered by
+// ShiftTable::faceSite, only their halos are sent
+template <typename T, int N>
+void decomp_face_plus(int lo, int hi, int id,
+                      SpinorT<T>* const* sp, HalfSpinorBlockT<T, N>* chi,
+                      PackedGaugeT<T> (*gauge)[4], int cb,
+                      ShiftTable<T, N>* sTab,
+                      SweepEpilogueT<T> const* ep);
+
+template <typename T, int N>
+void decomp_face_minus(int lo, int hi, int id,
+                       SpinorT<T>* const* sp, HalfSpinorBlockT<T, N>* chi,
+                       PackedGaugeT<T> (*gauge)[4], int cb,
+                       ShiftTable<T, N>* sTab,
+                       SweepEpilogueT<T> const* ep);
+
+// GAUGE_DOUBLE_STORED: target sites [lo, hi) as ordered by
+// ShiftTable::targetSite gather from the sources src of their on node
+// neighbours and from the receive buffers, in one sweep. gauge[site] holds
+// U(x, mu) and then U(x - mu, mu) of each direction
+template <typename T, int N>
+void gather_plus(int lo, int hi, int id,
+                 SpinorT<T>* const* sp, SpinorT<T>* const* src,
+                 PackedGaugeT<T> (*gauge)[8], int cb,
+                 ShiftTable<T, N>* sTab,
+                 SweepEpilogueT<T> const* ep);
+
+template <typename T, int N>
+void gather_minus(int lo, int hi, int id,
+                  SpinorT<T>* const* sp, SpinorT<T>* const* src,
+                  PackedGaugeT<T> (*gauge)[8], int cb,
+                  ShiftTable<T, N>* sTab,
+                  SweepEpilogueT<T> const* ep);
 
 } // namespace Chroma
 
@@ -0,0 +1,454 @@
+#ifndef NEON_DSLASH_SIMD_H
+#define NEON_DSLASH_SIMD_H
+
+// Thin 4-lane float (and double) SIMD layer used by the dslash kernels.
+// The backend is picked at configure time (--enable-simd) through one of
+// DSLASH_SIMD_NEON, DSLASH_SIMD_SSE, DSLASH_SIMD_AVX2 or DSLASH_SIMD_SCALAR.
+// If none is given we fall back on the compiler's target macros.
+// vdouble4 holds 4 doubles in two 2-lane registers (one __m256d for AVX2)
+// and provides the same operations, so the kernels can be written once.
+// vld_f16/vst_f16 convert between 4 lanes and IEEE fp16 kept as uint16_t,
+// with F16C on x86 when the compiler targets it.
+
+#include <cstdint>
+
+#if !defined(DSLASH_SIMD_NEON) && !defined(DSLASH_SIMD_SSE) && \
+    !defined(DSLASH_SIMD_AVX2) && !defined(DSLASH_SIMD_SCALAR)
+#  if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#    define DSLASH_SIMD_NEON
+#  elif defined(__AVX2__) && defined(__FMA__)
+#    define DSLASH_SIMD_AVX2
+#  elif defined(__SSE2__)
+#    define DSLASH_SIMD_SSE
+#  else
+#    define DSLASH_SIMD_SCALAR
+#  endif
+#endif
+
+#if defined(DSLASH_SIMD_NEON)
+#  include <arm_neon.h>
+#elif defined(DSLASH_SIMD_SSE) || defined(DSLASH_SIMD_AVX2)
+#  include <immintrin.h>
+#endif
+#include <cstring>
+
+namespace Chroma
+{
+namespace Simd
+{
+
+// IEEE fp16 conversion, round to nearest even
+inline uint16_t float_to_half(float f)
+{
+    uint32_t x;
+    std::memcpy(&x, &f, sizeof(x));
+    uint32_t sign = (x >> 16) & 0x8000;
+    uint32_t absx = x & 0x7fffffff;
+
+    if (absx >= 0x47800000) {
+        // nan stays nan, everything else overflows to inf
+        return sign | (absx > 0x7f800000 ? 0x7e00 : 0x7c00);
+    }
+
+    if (absx < 0x38800000) {
+        // subnormal in fp16
+        if (absx < 0x33000000) {
+            return sign;
+        }
+        uint32_t e = absx >> 23;
+        uint32_t m = (absx & 0x7fffff) | 0x800000;
+        uint32_t shift = 126 - e;
+        uint32_t h = m >> shift;
+        uint32_t rem = m & ((1u << shift) - 1);
+        uint32_t halfway = 1u << (shift - 1);
+        if (rem > halfway || (rem == halfway && (h & 1))) {
+            ++h;
+        }
+        return sign | h;
+    }
+
+    // rebias the exponent. a carry out of the mantissa may round up to inf
+    uint32_t h = (absx - 0x38000000) >> 13;
+    uint32_t rem = absx & 0x1fff;
+    if (rem > 0x1000 || (rem == 0x1000 && (h & 1))) {
+        ++h;
+    }
+    return sign | h;
+}
+
+inline float half_to_float(uint16_t h)
+{
+    uint32_t sign = (uint32_t)(h & 0x8000) << 16;
+    uint32_t e = (h >> 10) & 0x1f;
+    uint32_t m = h & 0x3ff;
+    uint32_t x;
+
+    if (e == 0) {
+        float f = m * 5.9604644775390625e-8f; // m * 2^-24
+        return sign ? -f : f;
+    } else if (e == 31) {
+        x = sign | 0x7f800000 | (m << 13);
+    } else {
+        x = sign | ((e + 112) << 23) | (m << 13);
+    }
+
+    float f;
+    std::memcpy(&f, &x, sizeof(f));
+    return f;
+}
+
+#if defined(DSLASH_SIMD_NEON)
+
+using vfloat4 = float32x4_t;
+using vmask4 = uint32x4_t;
+
+inline vfloat4 vld(const float* p) { return vld1q_f32(p); }
+inline vfloat4 vld_dup(const float* p) { return vld1q_dup_f32(p); }
+inline void vst(float* p, vfloat4 v) { vst1q_f32(p, v); }
+inline vmask4 vld_mask(const uint32_t* p) { return vld1q_u32(p); }
+inline vfloat4 vld_f16(const uint16_t* p) { return vcvt_f32_f16(vreinterpret_f16_u16(vld1_u16(p))); }
+inline void vst_f16(uint16_t* p, vfloat4 v) { vst1_u16(p, vreinterpret_u16_f16(vcvt_f16_f32(v))); }
+
+inline vfloat4 vadd(vfloat4 a, vfloat4 b) { return vaddq_f32(a, b); }
+inline vfloat4 vsub(vfloat4 a, vfloat4 b) { return vsubq_f32(a, b); }
+inline vfloat4 vmul(vfloat4 a, vfloat4 b) { return vmulq_f32(a, b); }
+// acc + a * b
+inline vfloat4 vfma(vfloat4 acc, vfloat4 a, vfloat4 b) { return vfmaq_f32(acc, a, b); }
+
+// (a2 a3 b0 b1), i.e. vextq_f32(a, b, 2)
+inline vfloat4 vext2(vfloat4 a, vfloat4 b) { return vextq_f32(a, b, 2); }
+// swap neighbouring lanes: (a1 a0 a3 a2)
+inline vfloat4 vrev64(vfloat4 a) { return vrev64q_f32(a); }
+// flip the sign bit of the lanes set in mask
+inline vfloat4 veor(vfloat4 a, vmask4 mask)
+{
+    return vreinterpretq_f32_u32(veorq_u32(vreinterpretq_u32_f32(a), mask));
+}
+
+// bytes (a multiple of 16) from src to 16 byte aligned dst with
+// non-temporal stores that do not allocate in the caches, STNP pairs.
+// stream_fence orders them before the data is handed on
+inline void stream_copy(void* dst, const void* src, size_t bytes)
+{
+    char* d = (char*)dst;
+    const char* s = (const char*)src;
+    size_t k = 0;
+    for (; k + 32 <= bytes; k += 32) {
+        float32x4_t a = vld1q_f32((const float*)(s + k));
+        float32x4_t b = vld1q_f32((const float*)(s + k + 16));
+        __asm__ volatile("stnp %q0, %q1, [%2]" : : "w"(a), "w"(b), "r"(d + k) : "memory");
+    }
+    if (k < bytes) {
+        vst1q_f32((float*)(d + k), vld1q_f32((const float*)(s + k)));
+    }
+}
+inline void stream_fence() { __asm__ volatile("dmb ishst" : : : "memory"); }
+
+// float64x2_t needs AArch64
+struct vdouble4 { float64x2_t lo, hi; };
+struct vmask4d { uint64x2_t lo, hi; };
+
+inline vdouble4 vld(const double* p) { return vdouble4{vld1q_f64(p), vld1q_f64(p + 2)}; }
+inline vdouble4 vld_dup(const double* p)
+{
+    float64x2_t v = vld1q_dup_f64(p);
+    return vdouble4{v, v};
+}
+inline void vst(double* p, vdouble4 v)
+{
+    vst1q_f64(p, v.lo);
+    vst1q_f64(p + 2, v.hi);
+}
+inline vmask4d vld_mask(const uint64_t* p) { return vmask4d{vld1q_u64(p), vld1q_u64(p + 2)}; }
+
+inline vdouble4 vadd(vdouble4 a, vdouble4 b) { return vdouble4{vaddq_f64(a.lo, b.lo), vaddq_f64(a.hi, b.hi)}; }
+inline vdouble4 vsub(vdouble4 a, vdouble4 b) { return vdouble4{vsubq_f64(a.lo, b.lo), vsubq_f64(a.hi, b.hi)}; }
+inline vdouble4 vmul(vdouble4 a, vdouble4 b) { return vdouble4{vmulq_f64(a.lo, b.lo), vmulq_f64(a.hi, b.hi)}; }
+inline vdouble4 vfma(vdouble4 acc, vdouble4 a, vdouble4 b)
+{
+    return vdouble4{vfmaq_f64(acc.lo, a.lo, b.lo), vfmaq_f64(acc.hi, a.hi, b.hi)};
+}
+
+inline vdouble4 vext2(vdouble4 a, vdouble4 b) { return vdouble4{a.hi, b.lo}; }
+inline vdouble4 vrev64(vdouble4 a) { return vdouble4{vextq_f64(a.lo, a.lo, 1), vextq_f64(a.hi, a.hi, 1)}; }
+inline vdouble4 veor(vdouble4 a, vmask4d mask)
+{
+    return vdouble4{vreinterpretq_f64_u64(veorq_u64(vreinterpretq_u64_f64(a.lo), mask.lo)),
+                    vreinterpretq_f64_u64(veorq_u64(vreinterpretq_u64_f64(a.hi), mask.hi))};
+}
+
+#elif defined(DSLASH_SIMD_SSE) || defined(DSLASH_SIMD_AVX2)
+
+using vfloat4 = __m128;
+using vmask4 = __m128;
+
+inline vfloat4 vld(const float* p) { return _mm_loadu_ps(p); }
+inline vfloat4 vld_dup(const float* p) { return _mm_set1_ps(*p); }
+inline void vst(float* p, vfloat4 v) { _mm_storeu_ps(p, v); }
+inline vmask4 vld_mask(const uint32_t* p)
+{
+    return _mm_castsi128_ps(_mm_loadu_si128((const __m128i*)p));
+}
+#if defined(__F16C__)
+inline vfloat4 vld_f16(const uint16_t* p)
+{
+    return _mm_cvtph_ps(_mm_loadl_epi64((const __m128i*)p));
+}
+inline void vst_f16(uint16_t* p, vfloat4 v)
+{
+    _mm_storel_epi64((__m128i*)p, _mm_cvtps_ph(v, _MM_FROUND_TO_NEAREST_INT));
+}
+#else
+inline vfloat4 vld_f16(const uint16_t* p)
+{
+    return _mm_setr_ps(half_to_float(p[0]), half_to_float(p[1]),
+                       half_to_float(p[2]), half_to_float(p[3]));
+}
+inline void vst_f16(uint16_t* p, vfloat4 v)
+{
+    float f[4];
+    _mm_storeu_ps(f, v);
+    for (int i = 0; i < 4; ++i) p[i] = float_to_half(f[i]);
+}
+#endif
+
+// bytes (a multiple of 16) from src to 16 byte aligned dst with
+// non-temporal stores that do not allocate in the caches, MOVNTPS.
+// stream_fence orders them before the data is handed on
+inline void stream_copy(void* dst, const void* src, size_t bytes)
+{
+    char* d = (char*)dst;
+    const char* s = (const char*)src;
+    for (size_t k = 0; k < bytes; k += 16) {
+        _mm_stream_ps((float*)(d + k), _mm_loadu_ps((const float*)(s + k)));
+    }
+}
+inline void stream_fence() { _mm_sfence(); }
+
+inline vfloat4 vadd(vfloat4 a, vfloat4 b) { return _mm_add_ps(a, b); }
+inline vfloat4 vsub(vfloat4 a, vfloat4 b) { return _mm_sub_ps(a, b); }
+inline vfloat4 vmul(vfloat4 a, vfloat4 b) { return _mm_mul_ps(a, b); }
+// acc + a * b
+inline vfloat4 vfma(vfloat4 acc, vfloat4 a, vfloat4 b)
+{
+#if defined(DSLASH_SIMD_AVX2)
+    return _mm_fmadd_ps(a, b, acc);
+#else
+    return _mm_add_ps(acc, _mm_mul_ps(a, b));
+#endif
+}
+
+// (a2 a3 b0 b1)
+inline vfloat4 vext2(vfloat4 a, vfloat4 b) { return _mm_shuffle_ps(a, b, _MM_SHUFFLE(1, 0, 3, 2)); }
+// (a1 a0 a3 a2)
+inline vfloat4 vrev64(vfloat4 a) { return _mm_shuffle_ps(a, a, _MM_SHUFFLE(2, 3, 0, 1)); }
+inline vfloat4 veor(vfloat4 a, vmask4 mask) { return _mm_xor_ps(a, mask); }
+
+#if defined(DSLASH_SIMD_AVX2)
+
+using vdouble4 = __m256d;
+using vmask4d = __m256d;
+
+inline vdouble4 vld(const double* p) { return _mm256_loadu_pd(p); }
+inline vdouble4 vld_dup(const double* p) { return _mm256_broadcast_sd(p); }
+inline void vst(double* p, vdouble4 v) { _mm256_storeu_pd(p, v); }
+inline vmask4d vld_mask(const uint64_t* p)
+{
+    return _mm256_castsi256_pd(_mm256_loadu_si256((const __m256i*)p));
+}
+
+inline vdouble4 vadd(vdouble4 a, vdouble4 b) { return _mm256_add_pd(a, b); }
+inline vdouble4 vsub(vdouble4 a, vdouble4 b) { return _mm256_sub_pd(a, b); }
+inline vdouble4 vmul(vdouble4 a, vdouble4 b) { return _mm256_mul_pd(a, b); }
+inline vdouble4 vfma(vdouble4 acc, vdouble4 a, vdouble4 b) { return _mm256_fmadd_pd(a, b, acc); }
+
+inline vdouble4 vext2(vdouble4 a, vdouble4 b) { return _mm256_permute2f128_pd(a, b, 0x21); }
+inline vdouble4 vrev64(vdouble4 a) { return _mm256_permute_pd(a, 0x5); }
+inline vdouble4 veor(vdouble4 a, vmask4d mask) { return _mm256_xor_pd(a, mask); }
+
+#else
+
+struct vdouble4 { __m128d lo, hi; };
+struct vmask4d { __m128d lo, hi; };
+
+inline vdouble4 vld(const double* p) { return vdouble4{_mm_loadu_pd(p), _mm_loadu_pd(p + 2)}; }
+inline vdouble4 vld_dup(const double* p)
+{
+    __m128d v = _mm_set1_pd(*p);
+    return vdouble4{v, v};
+}
+inline void vst(double* p, vdouble4 v)
+{
+    _mm_storeu_pd(p, v.lo);
+    _mm_storeu_pd(p + 2, v.hi);
+}
+inline vmask4d vld_mask(const uint64_t* p)
+{
+    return vmask4d{_mm_castsi128_pd(_mm_loadu_si128((const __m128i*)p)),
+                   _mm_castsi128_pd(_mm_loadu_si128((const __m128i*)(p + 2)))};
+}
+
+inline vdouble4 vadd(vdouble4 a, vdouble4 b) { return vdouble4{_mm_add_pd(a.lo, b.lo), _mm_add_pd(a.hi, b.hi)}; }
+inline vdouble4 vsub(vdouble4 a, vdouble4 b) { return vdouble4{_mm_sub_pd(a.lo, b.lo), _mm_sub_pd(a.hi, b.hi)}; }
+inline vdouble4 vmul(vdouble4 a, vdouble4 b) { return vdouble4{_mm_mul_pd(a.lo, b.lo), _mm_mul_pd(a.hi, b.hi)}; }
+inline vdouble4 vfma(vdouble4 acc, vdouble4 a, vdouble4 b) { return vadd(acc, vmul(a, b)); }
+
+inline vdouble4 vext2(vdouble4 a, vdouble4 b) { return vdouble4{a.hi, b.lo}; }
+inline vdouble4 vrev64(vdouble4 a)
+{
+    return vdouble4{_mm_shuffle_pd(a.lo, a.lo, 1), _mm_shuffle_pd(a.hi, a.hi, 1)};
+}
+inline vdouble4 veor(vdouble4 a, vmask4d mask)
+{
+    return vdouble4{_mm_xor_pd(a.lo, mask.lo), _mm_xor_pd(a.hi, mask.hi)};
+}
+
+#endif
+
+#else // DSLASH_SIMD_SCALAR
+
+struct vfloat4 { float v[4]; };
+struct vmask4 { uint32_t v[4]; };
+
+inline vfloat4 vld(const float* p)
+{
+    vfloat4 a;
+    std::memcpy(a.v, p, sizeof(a.v));
+    return a;
+}
+inline vfloat4 vld_dup(const float* p) { return vfloat4{{p[0], p[0], p[0], p[0]}}; }
+inline void vst(float* p, vfloat4 a)
+{
+    std::memcpy(p, a.v, sizeof(a.v));
+}
+inline vmask4 vld_mask(const uint32_t* p) { return vmask4{{p[0], p[1], p[2], p[3]}}; }
+inline vfloat4 vld_f16(const uint16_t* p)
+{
+    return vfloat4{{half_to_float(p[0]), half_to_float(p[1]),
+                    half_to_float(p[2]), half_to_float(p[3])}};
+}
+inline void vst_f16(uint16_t* p, vfloat4 a)
+{
+    for (int i = 0; i < 4; ++i) p[i] = float_to_half(a.v[i]);
+}
+
+// no streaming stores without SIMD
+inline void stream_copy(void* dst, const void* src, size_t bytes)
+{
+    std::memcpy(dst, src, bytes);
+}
+inline void stream_fence() {}
+
+inline vfloat4 vadd(vfloat4 a, vfloat4 b)
+{
+    for (int i = 0; i < 4; ++i) a.v[i] += b.v[i];
+    return a;
+}
+inline vfloat4 vsub(vfloat4 a, vfloat4 b)
+{
+    for (int i = 0; i < 4; ++i) a.v[i] -= b.v[i];
+    return a;
+}
+inline vfloat4 vmul(vfloat4 a, vfloat4 b)
+{
+    for (int i = 0; i < 4; ++i) a.v[i] *= b.v[i];
+    return a;
+}
+// acc + a * b
+inline vfloat4 vfma(vfloat4 acc, vfloat4 a, vfloat4 b)
+{
+    for (int i = 0; i < 4; ++i) acc.v[i] += a.v[i] * b.v[i];
+    return acc;
+}
+
+// (a2 a3 b0 b1)
+inline vfloat4 vext2(vfloat4 a, vfloat4 b) { return vfloat4{{a.v[2], a.v[3], b.v[0], b.v[1]}}; }
+// (a1 a0 a3 a2)
+inline vfloat4 vrev64(vfloat4 a) { return vfloat4{{a.v[1], a.v[0], a.v[3], a.v[2]}}; }
+inline vfloat4 veor(vfloat4 a, vmask4 mask)
+{
+    for (int i = 0; i < 4; ++i) {
+        uint32_t bits;
+        std::memcpy(&bits, &a.v[i], sizeof(bits));
+        bits ^= mask.v[i];
+        std::memcpy(&a.v[i], &bits, sizeof(bits));
+    }
+    return a;
+}
+
+struct vdouble4 { double v[4]; };
+struct vmask4d { uint64_t v[4]; };
+
+inline vdouble4 vld(const double* p)
+{
+    vdouble4 a;
+    std::memcpy(a.v, p, sizeof(a.v));
+    return a;
+}
+inline vdouble4 vld_dup(const double* p) { return vdouble4{{p[0], p[0], p[0], p[0]}}; }
+inline void vst(double* p, vdouble4 a)
+{
+    std::memcpy(p, a.v, sizeof(a.v));
+}
+inline vmask4d vld_mask(const uint64_t* p) { return vmask4d{{p[0], p[1], p[2], p[3]}}; }
+
+inline vdouble4 vadd(vdouble4 a, vdouble4 b)
+{
+    for (int i = 0; i < 4; ++i) a.v[i] += b.v[i];
+    return a;
+}
+inline vdouble4 vsub(vdouble4 a, vdouble4 b)
+{
+    for (int i = 0; i < 4; ++i) a.v[i] -= b.v[i];
+    return a;
+}
+inline vdouble4 vmul(vdouble4 a, vdouble4 b)
+{
+    for (int i = 0; i < 4; ++i) a.v[i] *= b.v[i];
+    return a;
+}
+inline vdouble4 vfma(vdouble4 acc, vdouble4 a, vdouble4 b)
+{
+    for (int i = 0; i < 4; ++i) acc.v[i] += a.v[i] * b.v[i];
+    return acc;
+}
+
+inline vdouble4 vext2(vdouble4 a, vdouble4 b) { return vdouble4{{a.v[2], a.v[3], b.v[0], b.v[1]}}; }
+inline vdouble4 vrev64(vdouble4 a) { return vdouble4{{a.v[1], a.v[0], a.v[3], a.v[2]}}; }
+inline vdouble4 veor(vdouble4 a, vmask4d mask)
+{
+    for (int i = 0; i < 4; ++i) {
+        uint64_t bits;
+        std::memcpy(&bits, &a.v[i], sizeof(bits));
+        bits ^= mask.v[i];
+        std::memcpy(&a.v[i], &bits, sizeof(bits));
+    }
+    return a;
+}
+
+#endif
+
+// vector and sign mask types of a real type
+template <typename T> struct VecTraits;
+
+template <> struct VecTraits<float>
+{
+    using vec = vfloat4;
+    using mask_bits = uint32_t;
+    static constexpr mask_bits sign = 0x80000000u;
+};
+
+template <> struct VecTraits<double>
+{
+    using vec = vdouble4;
+    using mask_bits = uint64_t;
+    static constexpr mask_bits sign = 0x8000000000000000ull;
+};
+
+template <typename T>
+using vreal4 = typename VecTraits<T>::vec;
+
+} // namespace Simd
+} // namespace Chroma
+
+#endif // NEON_DSLASH_SIMD_H
@@ -0,0 +1,91 @@
+#ifndef NEON_DSLASH_SOA_H
+#define NEON_DSLASH_SOA_H
+
+#include <memory>
+#include <vector>
+
+#include "neon_dslash_types.h"
+#include "dslash_table.h"
+
+namespace Chroma
+{
+
+// where the neighbour of a vector site in one direction comes from
+enum SoANeighbourKind {
+    SOA_LOCAL = 0,  // vector site 'site' of the source
+    SOA_HALO,       // entry 'face' of the receive buffer
+    SOA_LANE_SHIFT  // vector site 'site' shifted by a lane, the lane across
+                    // the node boundary from entry 'face' when >= 0
+};
+
+struct SoANeighbour
+{
+    int kind;
+    int site;
+    int face;
+};
+
+// Site vectorized (SoA) Wilson dslash, an alternative to NeonDslashT.
+// The subgrid is cut into SoALanes slabs along t and lane k of every
+// vector holds a site of slab k, so each kernel works on SoALanes sites
+// at once without shuffles or gauge broadcasts.
+//
+// The fields are in this layout, see importSpinor / exportSpinor. A SoA
+// spinor field takes as much memory as a plain one. Needs even subgrid
+// extents and subgrid[3] divisible by 2*SoALanes.
+template <typename T>
+class NeonDslashSoAT
+{
+public:
+    using Spinor = SpinorT<T>;
+    using SpinorSoA = SpinorSoAT<T>;
+    using HalfSpinorSoA = HalfSpinorSoAT<T>;
+    using HalfSpinorLane = HalfSpinorLaneT<T>;
+    using GaugeMatSoA = GaugeMatSoAT<T>;
+    using PackedGauge = PackedGaugeT<T>; // GaugeMat unless compressed
+
+    //! Empty constructor. Must use create later
+    NeonDslashSoAT() = default;
+    ~NeonDslashSoAT();
+
+    void create(int subgrid[], /* int subgrid[4] */
+                PackedGauge* packedGauge,
+                int (*getLinearSiteIndex)(const int coord[]),
+                HaloCompression haloCompression = HALO_UNCOMPRESSED);
+
+    // copy the links into the SoA layout. again after they changed
+    void importGauge(const PackedGauge* packedGauge);
+
+    // checkerboard cb of a field in the site order of getLinearSiteIndex
+    // to / from the SoA layout
+    void importSpinor(T* soa, const T* psi, int cb) const;
+    void exportSpinor(T* psi, const T* soa, int cb) const;
+
+    // chi = D psi on checkerboard cb, both in the SoA layout
+    void apply(T* chi, T* psi, int isign, int cb) const;
+
+private:
+    template <int isign>
+    void applySign(SpinorSoA* chi, const SpinorSoA* psi, int cb) const;
+
+    int vsubgrid[4];   // the subgrid in vector sites, t is cut by SoALanes
+    int vol_cb;        // vector sites per checkerboard
+
+    std::vector<int> siteIndex;            // [vector site][lane] -> getLinearSiteIndex
+    std::vector<SoANeighbour> neighbours;  // [vector site][mu][forward, backward]
+    std::vector<int> targetSites[2][2];    // [cb][interior, boundary]
+    std::vector<int> faceSites[2][2][4];   // [cb][lower, upper face][mu] in buffer order
+    int commIndex[4];                      // index of the comms buffers, -1 if local
+
+    QMP_mem_t* xgauge = 0;
+    GaugeMatSoA (*gauge)[4] = 0;
+
+    std::unique_ptr<DslashTable<T, SoALanes>> dslashTable;
+};
+
+using NeonDslashSoA = NeonDslashSoAT<float>;
+using NeonDslashSoAD = NeonDslashSoAT<double>;
+
+} // namespace Chroma
+
+#endif // NEON_DSLASH_SOA_H
@@ -0,0 +1,304 @@
+#ifndef NEON_DSLASH_SOA_DETAILS_H
+#define NEON_DSLASH_SOA_DETAILS_H
+
+// header only library, the kernels of NeonDslashSoAT. lane k of every
+// vector is the same component of the site in slab k, so there is no
+// swizzling and no broadcast of the gauge elements
+#include "neon_dslash_details.h"
+
+namespace
+{
+using Chroma::SoALanes;
+using Chroma::SpinorSoAT;
+using Chroma::GaugeMatSoAT;
+
+// a half spinor (2 spins x 3 colours) of SoALanes sites
+template <typename T>
+struct HalfSpinorVec
+{
+    vreal4<T> re[2][3];
+    vreal4<T> im[2][3];
+};
+
+// a spinor of SoALanes sites
+template <typename T>
+struct SpinorVec
+{
+    vreal4<T> re[4][3];
+    vreal4<T> im[4][3];
+};
+
+// (1 + s gamma_mu) psi in the DeGrand-Rossi basis. for s = +1 the upper
+// spins are h_j = psi_j + i^projUnit psi_projSpin and the lower ones are
+// i^reconUnit h_reconSpin. s = -1 adds 2 to the powers of i
+constexpr int soaProjSpin[4][2] = {{3, 2}, {3, 2}, {2, 3}, {2, 3}};
+constexpr int soaProjUnit[4][2] = {{1, 1}, {2, 0}, {1, 3}, {0, 0}};
+constexpr int soaReconSpin[4][2] = {{1, 0}, {1, 0}, {0, 1}, {0, 1}};
+constexpr int soaReconUnit[4][2] = {{3, 3}, {0, 2}, {3, 1}, {0, 0}};
+
+constexpr int signedUnit(int unit, int s)
+{
+    return (unit + (s < 0 ? 2 : 0)) & 3;
+}
+
+// (re, im) += i^K (xre, xim)
+template <int K, typename V>
+inline void madd_unit(V& re, V& im, V xre, V xim)
+{
+    switch (K) {
+    case 0:
+        re = vadd(re, xre);
+        im = vadd(im, xim);
+        break;
+    case 1:
+        re = vsub(re, xim);
+        im = vadd(im, xre);
+        break;
+    case 2:
+        re = vsub(re, xre);
+        im = vsub(im, xim);
+        break;
+    default:
+        re = vadd(re, xim);
+        im = vsub(im, xre);
+        break;
+    }
+}
+
+// upper spins of (1 + S gamma_Mu) psi
+template <int Mu, int S, typename T>
+inline void soa_project(SpinorSoAT<T> const& psi, HalfSpinorVec<T>& h)
+{
+    for (int j = 0; j < 2; ++j) {
+        for (int c = 0; c < 3; ++c) {
+            h.re[j][c] = vld(psi[j][c][0]);
+            h.im[j][c] = vld(psi[j][c][1]);
+        }
+    }
+
+    for (int c = 0; c < 3; ++c) {
+        madd_unit<signedUnit(soaProjUnit[Mu][0], S)>(h.re[0][c], h.im[0][c],
+                                                     vld(psi[soaProjSpin[Mu][0]][c][0]),
+                                                     vld(psi[soaProjSpin[Mu][0]][c][1]));
+        madd_unit<signedUnit(soaProjUnit[Mu][1], S)>(h.re[1][c], h.im[1][c],
+                                                     vld(psi[soaProjSpin[Mu][1]][c][0]),
+                                                     vld(psi[soaProjSpin[Mu][1]][c][1]));
+    }
+}
+
+// acc += the full spinor of the upper spins h of (1 + S gamma_Mu) psi
+template <int Mu, int S, typename T>
+inline void soa_accumulate(SpinorVec<T>& acc, HalfSpinorVec<T> const& h)
+{
+    for (int c = 0; c < 3; ++c) {
+        acc.re[0][c] = vadd(acc.re[0][c], h.re[0][c]);
+        acc.im[0][c] = vadd(acc.im[0][c], h.im[0][c]);
+        acc.re[1][c] = vadd(acc.re[1][c], h.re[1][c]);
+        acc.im[1][c] = vadd(acc.im[1][c], h.im[1][c]);
+
+        madd_unit<signedUnit(soaReconUnit[Mu][0], S)>(acc.re[2][c], acc.im[2][c],
+                                                      h.re[soaReconSpin[Mu][0]][c],
+                                                      h.im[soaReconSpin[Mu][0]][c]);
+        madd_unit<signedUnit(soaReconUnit[Mu][1], S)>(acc.re[3][c], acc.im[3][c],
+                                                      h.re[soaReconSpin[Mu][1]][c],
+                                                      h.im[soaReconSpin[Mu][1]][c]);
+    }
+}
+
+// U * h, the link is packed as mat[n][m] = U(m,n)
+template <typename T>
+inline void soa_mult_u(GaugeMatSoAT<T> const& mat, HalfSpinorVec<T> const& h,
+                       HalfSpinorVec<T>& out)
+{
+    for (int m = 0; m < 3; ++m) {
+        vreal4<T> ur = vld(mat[0][m][0]);
+        vreal4<T> ui = vld(mat[0][m][1]);
+
+        // re = sum ur hr - sum ui hi, the second sum in rr
+        vreal4<T> re[2], rr[2], im[2];
+        for (int j = 0; j < 2; ++j) {
+            re[j] = vmul(ur, h.re[j][0]);
+            rr[j] = vmul(ui, h.im[j][0]);
+            im[j] = vfma(vmul(ur, h.im[j][0]), ui, h.re[j][0]);
+        }
+
+        for (int n = 1; n < 3; ++n) {
+            ur = vld(mat[n][m][0]);
+            ui = vld(mat[n][m][1]);
+            for (int j = 0; j < 2; ++j) {
+                re[j] = vfma(re[j], ur, h.re[j][n]);
+                rr[j] = vfma(rr[j], ui, h.im[j][n]);
+                im[j] = vfma(vfma(im[j], ur, h.im[j][n]), ui, h.re[j][n]);
+            }
+        }
+
+        for (int j = 0; j < 2; ++j) {
+            out.re[j][m] = vsub(re[j], rr[j]);
+            out.im[j][m] = im[j];
+        }
+    }
+}
+
+// adj(U) * h
+template <typename T>
+inline void soa_mult_adj_u(GaugeMatSoAT<T> const& mat, HalfSpinorVec<T> const& h,
+                           HalfSpinorVec<T>& out)
+{
+    for (int m = 0; m < 3; ++m) {
+        vreal4<T> ur = vld(mat[m][0][0]);
+        vreal4<T> ui = vld(mat[m][0][1]);
+
+        // im = sum ur hi - sum ui hr, the second sum in ii
+        vreal4<T> re[2], im[2], ii[2];
+        for (int j = 0; j < 2; ++j) {
+            re[j] = vfma(vmul(ur, h.re[j][0]), ui, h.im[j][0]);
+            im[j] = vmul(ur, h.im[j][0]);
+            ii[j] = vmul(ui, h.re[j][0]);
+        }
+
+        for (int n = 1; n < 3; ++n) {
+            ur = vld(mat[m][n][0]);
+            ui = vld(mat[m][n][1]);
+            for (int j = 0; j < 2; ++j) {
+                re[j] = vfma(vfma(re[j], ur, h.re[j][n]), ui, h.im[j][n]);
+                im[j] = vfma(im[j], ur, h.im[j][n]);
+                ii[j] = vfma(ii[j], ui, h.re[j][n]);
+            }
+        }
+
+        for (int j = 0; j < 2; ++j) {
+            out.re[j][m] = re[j];
+            out.im[j][m] = vsub(im[j], ii[j]);
+        }
+    }
+}
+
+// half spinors of the comms buffers, HalfSpinorSoAT
+template <typename H, typename T>
+inline void soa_load_half(H const (&buf)[2][3][2][SoALanes], HalfSpinorVec<T>& h)
+{
+    for (int j = 0; j < 2; ++j) {
+        for (int c = 0; c < 3; ++c) {
+            h.re[j][c] = vld_hs(buf[j][c][0]);
+            h.im[j][c] = vld_hs(buf[j][c][1]);
+        }
+    }
+}
+
+template <typename H, typename T>
+inline void soa_store_half(H (&buf)[2][3][2][SoALanes], HalfSpinorVec<T> const& h)
+{
+    for (int j = 0; j < 2; ++j) {
+        for (int c = 0; c < 3; ++c) {
+            vst_hs(buf[j][c][0], h.re[j][c]);
+            vst_hs(buf[j][c][1], h.im[j][c]);
+        }
+    }
+}
+
+// one lane of the half spinors, the t faces carry only the lane the
+// neighbour node uses
+inline float hs_real(uint16_t x) { return half_to_float(x); }
+inline float hs_real(float x) { return x; }
+inline double hs_real(double x) { return x; }
+inline void hs_set(uint16_t& dst, float x) { dst = float_to_half(x); }
+inline void hs_set(float& dst, float x) { dst = x; }
+inline void hs_set(double& dst, double x) { dst = x; }
+
+template <int Lane, typename H, typename T>
+inline void soa_store_lane(H (&buf)[2][3][2], HalfSpinorVec<T> const& h)
+{
+    T t[SoALanes];
+    for (int j = 0; j < 2; ++j) {
+        for (int c = 0; c < 3; ++c) {
+            vst(t, h.re[j][c]);
+            hs_set(buf[j][c][0], t[Lane]);
+            vst(t, h.im[j][c]);
+            hs_set(buf[j][c][1], t[Lane]);
+        }
+    }
+}
+
+template <typename T>
+inline void soa_store_spinor(SpinorSoAT<T>& psi, SpinorVec<T> const& acc)
+{
+    for (int s = 0; s < 4; ++s) {
+        for (int c = 0; c < 3; ++c) {
+            vst(psi[s][c][0], acc.re[s][c]);
+            vst(psi[s][c][1], acc.im[s][c]);
+        }
+    }
+}
+
+template <typename T>
+inline void soa_zero(SpinorVec<T>& acc)
+{
+    T const zero = 0;
+    vreal4<T> z = vld_dup(&zero);
+    for (int s = 0; s < 4; ++s) {
+        for (int c = 0; c < 3; ++c) {
+            acc.re[s][c] = z;
+            acc.im[s][c] = z;
+        }
+    }
+}
+
+// the neighbours across the ends of the slabs sit one lane over. only
+// a 1/(subgrid[3]/SoALanes) fraction of the sites needs these, so they go
+// through memory instead of backend specific permutes
+
+// lanes (a1, a2, .., b0): forward, b0 is the start of the next slab. it
+// is *next from the halo, a0 when the slabs wrap around on the node
+template <typename T, typename H>
+inline vreal4<T> soa_lanes_fwd(vreal4<T> a, H const* next)
+{
+    T ta[SoALanes];
+    vst(ta, a);
+    T b0 = next != 0 ? hs_real(*next) : ta[0];
+    for (int l = 0; l < SoALanes - 1; ++l) {
+        ta[l] = ta[l + 1];
+    }
+    ta[SoALanes - 1] = b0;
+    return vld(ta);
+}
+
+// lanes (bn, a0, a1, ..): backward, bn is the end of the previous slab
+template <typename T, typename H>
+inline vreal4<T> soa_lanes_back(vreal4<T> a, H const* prev)
+{
+    T ta[SoALanes];
+    vst(ta, a);
+    T bn = prev != 0 ? hs_real(*prev) : ta[SoALanes - 1];
+    for (int l = SoALanes - 1; l > 0; --l) {
+        ta[l] = ta[l - 1];
+    }
+    ta[0] = bn;
+    return vld(ta);
+}
+
+// next / prev is the one site entry of the t halo, null if t is local
+template <typename T, typename H>
+inline void soa_shift_fwd(HalfSpinorVec<T>& h, H const (*next)[3][2])
+{
+    for (int j = 0; j < 2; ++j) {
+        for (int c = 0; c < 3; ++c) {
+            h.re[j][c] = soa_lanes_fwd<T>(h.re[j][c], next != 0 ? &next[j][c][0] : (H const*) 0);
+            h.im[j][c] = soa_lanes_fwd<T>(h.im[j][c], next != 0 ? &next[j][c][1] : (H const*) 0);
+        }
+    }
+}
+
+template <typename T, typename H>
+inline void soa_shift_back(HalfSpinorVec<T>& h, H const (*prev)[3][2])
+{
+    for (int j = 0; j < 2; ++j) {
+        for (int c = 0; c < 3; ++c) {
+            h.re[j][c] = soa_lanes_back<T>(h.re[j][c], prev != 0 ? &prev[j][c][0] : (H const*) 0);
+            h.im[j][c] = soa_lanes_back<T>(h.im[j][c], prev != 0 ? &prev[j][c][1] : (H const*) 0);
+        }
+    }
+}
+
+} // namespace anonymous
+
+#endif // NEON_DSLASH_SOA_DETAILS_H
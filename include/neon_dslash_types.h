@@ -2,18 +2,172 @@
 #define NEON_DSLASH_TYPES_H
 
 #include <cstddef>
+#include <cstdint>
+
+#include "neon_dslash_config.h"
 
 namespace Chroma
 {
-// some primitive types:
-using Spinor = float[4][3][2]; 
-using HalfSpinor = float[3][2][2]; // transposed to fit 4-lane simd
-using GaugeMat = float[3][3][2];
+// the half spinor temporaries (chi1, chi2 and the comms buffers) have the
+// precision of the operator. single precision ones are IEEE fp16 bits
+// instead when built with DSLASH_HALF_CHI, see neon_dslash_config.h
+template <typename T>
+struct HalfSpinorRealOf
+{
+    using type = T;
+};
+
+#ifdef DSLASH_HALF_CHI
+template <>
+struct HalfSpinorRealOf<float>
+{
+    using type = uint16_t;
+};
+#endif
+
+// some primitive types, T is float or double:
+template <typename T>
+using SpinorT = T[4][3][2];
+template <typename T>
+using HalfSpinorT = typename HalfSpinorRealOf<T>::type[3][2][2]; // transposed to fit 4-lane simd
+template <typename T>
+using GaugeMatT = T[3][3][2];
+
+// the half spinors of N right hand sides for one site and direction. the
+// temporaries and comms buffers of an N source operator are made of these
+template <typename T, int N>
+using HalfSpinorBlockT = HalfSpinorT<T>[N];
+
+// the clover term A (or its inverse) of a site, two hermitian 6x6 blocks
+// acting on spins 0, 1 and spins 2, 3 with index 3*spin + colour. the real
+// diagonals, then the lower triangles row by row: offd[b][i*(i-1)/2 + j]
+// is A(i,j) for i > j. the layout of Chroma's PrimitiveClovTriang
+template <typename T>
+struct PackedCloverT
+{
+    T diag[2][6];
+    T offd[2][15][2];
+};
+
+// the fifth dimension of the Mobius domain wall operator, the N = Ls
+// sources are its s slices. the mix with coefficients c is
+// (c[0] + c[1] P) psi, (P psi)_s = P_- psi_{s+1} + P_+ psi_{s-1} with
+// psi_{Ls} = -mass psi_0 and psi_{-1} = -mass psi_{Ls-1}. P_+ and P_- are
+// the upper and lower spins in the DeGrand-Rossi basis, the dagger of P
+// swaps them.
+// the decomp sweeps mix the sources with hop before the hop, the dagger
+// mixes the results in the recons sweeps instead. diag mixes x for the
+// axpy of the epilogue
+template <typename T>
+struct FifthDimT
+{
+    T hop[2];
+    T diag[2];
+    T mass;
+    bool dagger;
+};
+
+// which stores of the sweeps bypass the caches (non-temporal), a bit set.
+// pays off when the fields and the temporaries exceed the last level cache
+enum StreamingStores {
+    STREAM_NONE = 0,
+    STREAM_HALF_SPINORS = 1,   // the decomp scatters to chi1, chi2 and the send buffers
+    STREAM_RESULT = 2          // the results of the fused recons sweeps
+};
+
+// what the recons sweeps do to a target site once its hops are summed:
+// chi = a x + b A D psi. no clover term A when clover is null and just
+// A D psi when x is null. x has N fields like the sources, indexed like
+// the gauge field. with sums set they also accumulate |chi|^2 and, with y
+// set, <y, chi> of each source r into sums[id*sweepSumStride<N>() + 3*r + k]
+// of thread id. a twist (t[0] + i t[1] gamma5) multiplies A D psi and
+// xTwist multiplies x when they are set. with fifth the N sources are the
+// slices of a 5D field, see FifthDimT. streaming are the StreamingStores
+// of all the sweeps
+template <typename T>
+struct SweepEpilogueT
+{
+    PackedCloverT<T> const* clover;
+    SpinorT<T>* const* x;
+    T a;
+    T b;
+    SpinorT<T>* const* y;
+    double* sums;
+    T const* twist;
+    T const* xTwist;
+    FifthDimT<T> const* fifth;
+    int streaming;
+};
+
+// the site vectorized (SoA) layout of NeonDslashSoAT: lane k of the
+// innermost index holds the component of the site in slab k
+constexpr int SoALanes = 4;
+
+template <typename T>
+using SpinorSoAT = T[4][3][2][SoALanes];
+template <typename T>
+using HalfSpinorSoAT = typename HalfSpinorRealOf<T>::type[2][3][2][SoALanes];
+template <typename T>
+using HalfSpinorLaneT = typename HalfSpinorRealOf<T>::type[2][3][2]; // one lane of a HalfSpinorSoAT
+template <typename T>
+using GaugeMatSoAT = T[3][3][2][SoALanes]; // [n][m] = U(m,n) as GaugeMatT
+
+// compressed gauge links, see neon_dslash_gauge.h. each is s * V with V in
+// SU(3) and s a real scale (anisotropy, boundary signs)
+//
+// 12 reals (and 1/s): the first two rows of s * V, the third row is
+// rebuilt from their cross product
+template <typename T>
+struct GaugeLink12
+{
+    T rows[2][3][2];
+    T invScale;
+};
+
+// 8 reals (and s): V01, V02, V10 and the phases of V00 and V20
+template <typename T>
+struct GaugeLink8
+{
+    T v01[2];
+    T v02[2];
+    T v10[2];
+    T argV00;
+    T argV20;
+    T scale;
+};
+
+// the gauge links the operator reads, chosen with DSLASH_GAUGE_RECONSTRUCT
+// in neon_dslash_config.h
+#if DSLASH_GAUGE_RECONSTRUCT == 12
+template <typename T>
+using PackedGaugeT = GaugeLink12<T>;
+#elif DSLASH_GAUGE_RECONSTRUCT == 8
+template <typename T>
+using PackedGaugeT = GaugeLink8<T>;
+#else
+template <typename T>
+using PackedGaugeT = GaugeMatT<T>;
+#endif
+
+// single precision
+using HalfSpinorReal = HalfSpinorRealOf<float>::type;
+using Spinor = SpinorT<float>;
+using HalfSpinor = HalfSpinorT<float>;
+using GaugeMat = GaugeMatT<float>;
 
 namespace Cache
 {
 constexpr size_t CacheLineSize = 64;
 constexpr size_t CacheSetSize = 32*1024;
+constexpr size_t CacheL2Size = 512*1024;
+}
+
+// the partial sums of a thread, padded to a cache line
+template <int N>
+constexpr int sweepSumStride()
+{
+    return (3*N*sizeof(double) + Cache::CacheLineSize - 1) / Cache::CacheLineSize
+        * Cache::CacheLineSize / sizeof(double);
 }
 } // end namespace Chroma
 
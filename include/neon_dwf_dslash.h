@@ -0,0 +1,95 @@
+#ifndef NEON_DWF_DSLASH_H
+#define NEON_DWF_DSLASH_H
+
+#include "neon_dslash.h"
+
+namespace Chroma
+{
+
+// Mobius domain wall operator on Ls slices, Shamir for c5 = 0:
+// D5 = (b5 D_W + 1) + (c5 D_W - 1) P with D_W = (4 - M5) - Dslash/2 and P
+// the hop in s with the mass at the walls, see FifthDimT.
+// the slices are the sources of NeonDslashT<T, Ls>: each link is loaded
+// once for all of them and their halos travel in one message per
+// direction. the s structure is done by the decomp (or, for the dagger,
+// recons) sweeps on the slices of a site while they are in L1.
+// Ls is one of the source counts NeonDslashT is instantiated for, which
+// covers the usual Ls = 8 to 24 in steps of 4. another Ls needs its line
+// in each of the instantiation lists of lib/
+template <typename T, int Ls>
+class NeonMobiusDslashT : public NeonDslashT<T, Ls>
+{
+public:
+    using PackedGauge = typename NeonDslashT<T, Ls>::PackedGauge;
+
+    //! Empty constructor. Must use create later
+    NeonMobiusDslashT() = default;
+
+    void create(int subgrid[], /* int subgrid[4] */
+                PackedGauge* packedGauge,
+                T wallHeight, T b5, T c5, T mass,
+                void (*getSiteCoords)(int coord[], int node, int linear),
+                int (*getLinearSiteIndex)(const int coord[]),
+                int (*getNodeNumber)(const int coord[]),
+                HaloCompression haloCompression = HALO_UNCOMPRESSED,
+                SiteOrder siteOrder = SITE_ORDER_LEXICOGRAPHIC,
+                FieldLayout fieldLayout = FIELD_LAYOUT_QDP,
+                GaugeLayout gaugeLayout = GAUGE_SINGLE)
+    {
+        NeonDslashT<T, Ls>::create(subgrid, packedGauge,
+                                   getSiteCoords, getLinearSiteIndex, getNodeNumber,
+                                   haloCompression, siteOrder, fieldLayout,
+                                   gaugeLayout);
+        m5 = wallHeight;
+        b = b5;
+        c = c5;
+        m = mass;
+    }
+
+    // chi = D5 psi (D5^dagger for isign = -1) on checkerboard cb. psi[s]
+    // is slice s with both checkerboards, the s diagonal part reads cb
+    // of it. chi must not alias psi
+    void apply(T* const chi[], T* const psi[], int isign, int cb) const
+    {
+        T diag = 4 - m5;
+        FifthDimT<T> fifth = {{-b/2, -c/2}, {b*diag + 1, c*diag - 1}, m, isign == -1};
+
+        SpinorT<T>* x[Ls];
+        for (int s = 0; s < Ls; ++s) {
+            x[s] = (SpinorT<T>*) psi[s];
+        }
+
+        typename NeonDslashT<T, Ls>::SweepEpilogue ep{};
+        ep.x = x;
+        ep.a = 1;
+        ep.b = 1;
+        ep.fifth = &fifth;
+        this->applyFused(chi, psi, isign, cb, ep);
+    }
+
+    // the hopping part alone, chi = Dslash (b5 + c5 P) psi on checkerboard
+    // cb, (b5 + c5 P^dagger) Dslash^dagger psi for isign = -1
+    void applyHop(T* const chi[], T* const psi[], int isign, int cb) const
+    {
+        FifthDimT<T> fifth = {{b, c}, {0, 0}, m, isign == -1};
+
+        typename NeonDslashT<T, Ls>::SweepEpilogue ep{};
+        ep.fifth = &fifth;
+        this->applyFused(chi, psi, isign, cb, ep);
+    }
+
+private:
+    T m5 = 0;
+    T b = 1;
+    T c = 0;
+    T m = 0;
+};
+
+template <int Ls>
+using NeonMobiusDslash = NeonMobiusDslashT<float, Ls>;
+template <int Ls>
+using NeonMobiusDslashD = NeonMobiusDslashT<double, Ls>;
+
+} // namespace Chroma
+
+#endif // NEON_DWF_DSLASH_H
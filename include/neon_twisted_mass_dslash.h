@@ -0,0 +1,128 @@
+#ifndef NEON_TWISTED_MASS_DSLASH_H
+#define NEON_TWISTED_MASS_DSLASH_H
+
+#include "neon_dslash.h"
+
+namespace Chroma
+{
+
+// which twist apply multiplies with, A = 1 + i mu gamma5 tau3
+enum TwistTerm {
+    TWIST_A = 0,    // A D psi
+    TWIST_A_INV     // A^-1 D psi = (1 - i mu gamma5 tau3) / (1 + mu^2) D psi
+};
+
+// the flavour of the degenerate doublet, the sign of mu
+enum TwistFlavour {
+    TWIST_UP = 1,
+    TWIST_DOWN = -1
+};
+
+// Wilson dslash with the twisted mass term of the degenerate doublet.
+// the flavours decouple, each is applied on its own. the twist is done by
+// the recons sweeps like the clover term, isign = -1 takes the hermitian
+// conjugate twist (mu -> -mu) along with D^dagger.
+// applySchur with isign = -1 is the adjoint of the isign = 1 operator.
+// apply with isign = -1 is A^dagger D^dagger, which is NOT (A D)^dagger =
+// D^dagger A^dagger: gamma5 anticommutes with the gamma_mu of D. for the
+// adjoint twist the source with A^dagger, then do the plain hopping
+// apply with isign = -1.
+// the non-degenerate doublet mixes the flavours and is not done here
+template <typename T, int N = 1>
+class NeonTwistedMassDslashT : public NeonDslashT<T, N>
+{
+public:
+    using PackedGauge = typename NeonDslashT<T, N>::PackedGauge;
+
+    //! Empty constructor. Must use create later
+    NeonTwistedMassDslashT() = default;
+
+    void create(int subgrid[], /* int subgrid[4] */
+                PackedGauge* packedGauge,
+                T twistedMass,
+                void (*getSiteCoords)(int coord[], int node, int linear),
+                int (*getLinearSiteIndex)(const int coord[]),
+                int (*getNodeNumber)(const int coord[]),
+                HaloCompression haloCompression = HALO_UNCOMPRESSED,
+                SiteOrder siteOrder = SITE_ORDER_LEXICOGRAPHIC,
+                FieldLayout fieldLayout = FIELD_LAYOUT_QDP,
+                GaugeLayout gaugeLayout = GAUGE_SINGLE)
+    {
+        NeonDslashT<T, N>::create(subgrid, packedGauge,
+                                  getSiteCoords, getLinearSiteIndex, getNodeNumber,
+                                  haloCompression, siteOrder, fieldLayout,
+                                  gaugeLayout);
+        mu = twistedMass;
+    }
+
+    // the plain hopping term
+    using NeonDslashT<T, N>::apply;
+
+    // chi[r] = A D psi[r] or A^-1 D psi[r] for the N sources r. isign = -1
+    // gives A^dagger D^dagger psi[r] (A^-1 likewise), not the adjoint
+    void apply(T* const chi[], T* const psi[], int isign, int cb,
+               TwistTerm term, TwistFlavour flavour = TWIST_UP) const
+    {
+        T twist[2];
+        twistFactor(twist, term, isign*flavour);
+        typename NeonDslashT<T, N>::SweepEpilogue ep{};
+        ep.twist = twist;
+        this->applyFused(chi, psi, isign, cb, ep);
+    }
+
+    void apply(T* chi, T* psi, int isign, int cb,
+               TwistTerm term, TwistFlavour flavour = TWIST_UP) const
+    {
+        static_assert(N == 1, "NeonTwistedMassDslashT: pass N fields");
+        apply(&chi, &psi, isign, cb, term, flavour);
+    }
+
+    // the even-odd preconditioned operator on checkerboard cb,
+    // chi[r] = A psi[r] - kappa^2 D A^-1 D psi[r], and its dagger for
+    // isign = -1. A^-1 is applied by the first hop's recons sweeps and A
+    // psi by the axpy of the second's. chi must not alias psi
+    void applySchur(T* const chi[], T* const psi[], T kappa, int isign, int cb,
+                    TwistFlavour flavour = TWIST_UP) const
+    {
+        T inv[2];
+        T twist[2];
+        twistFactor(inv, TWIST_A_INV, isign*flavour);
+        twistFactor(twist, TWIST_A, isign*flavour);
+
+        typename NeonDslashT<T, N>::SweepEpilogue hop{};
+        typename NeonDslashT<T, N>::SweepEpilogue last{};
+        hop.twist = inv;
+        last.xTwist = twist;
+        this->applySchurFused(chi, psi, kappa, isign, cb, hop, last, 0);
+    }
+
+    void applySchur(T* chi, T* psi, T kappa, int isign, int cb,
+                    TwistFlavour flavour = TWIST_UP) const
+    {
+        static_assert(N == 1, "NeonTwistedMassDslashT: pass N fields");
+        applySchur(&chi, &psi, kappa, isign, cb, flavour);
+    }
+
+private:
+    // the twist of sign s*mu as (re, im of the gamma5 part)
+    void twistFactor(T twist[2], TwistTerm term, int s) const
+    {
+        if (term == TWIST_A) {
+            twist[0] = 1;
+            twist[1] = s*mu;
+        } else {
+            T norm = 1/(1 + mu*mu);
+            twist[0] = norm;
+            twist[1] = -s*mu*norm;
+        }
+    }
+
+    T mu = 0;
+};
+
+using NeonTwistedMassDslash = NeonTwistedMassDslashT<float>;
+using NeonTwistedMassDslashD = NeonTwistedMassDslashT<double>;
+
+} // namespace Chroma
+
+#endif // NEON_TWISTED_MASS_DSLASH_H
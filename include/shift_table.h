@@ -3,6 +3,8 @@
 
 #include "neon_dslash_types.h"
 #include <memory>
+#include <string>
+#include <vector>
 #include "qmp.h"
 
 namespace Chroma
@@ -15,13 +17,57 @@ enum HalfSpinorOffsetType {
     RECONS_GATHER
 };
 
+// Which halo data a target site needs, from the directions in which its
+// RECONS_MVV_GATHER (receive from forward) and RECONS_GATHER (receive from
+// backward) neighbours are off node
+enum TargetSiteClass {
+    INTERIOR_SITES=0,          // no receive buffers at all
+    FORWARD_BOUNDARY_SITES,    // only the receive from forward
+    BOUNDARY_SITES,            // the receive from backward, maybe both
+    NUM_TARGET_SITE_CLASSES
+};
+
+// the order of the sites of a checkerboard in the sweeps and of their half
+// spinors in chi1 and chi2
+enum SiteOrder {
+    SITE_ORDER_LEXICOGRAPHIC=0,   // x fastest, then y, z, t
+    SITE_ORDER_TILED,             // 4D tiles whose data fits in L2, lexicographic
+                                  // within and across them
+    SITE_ORDER_MORTON             // Z-order curve of the coordinates
+};
+
+// the entries of the offset table are 32 bit: the buffer in the top
+// OffsetBaseBits, chi1, chi2, the send buffers then the receive buffers,
+// and the half spinor within it in the rest
+constexpr int OffsetBaseBits = 5;
+constexpr int OffsetIndexBits = 32 - OffsetBaseBits;
+constexpr uint32_t OffsetIndexMask = (1u << OffsetIndexBits) - 1;
+
+enum OffsetBase {
+    OFFSET_CHI1=0,
+    OFFSET_CHI2,
+    OFFSET_SEND_BUFS,                   // + 4*i + num as send_bufs[i][num]
+    OFFSET_RECV_BUFS = OFFSET_SEND_BUFS + 8,
+    NUM_OFFSET_BASES = OFFSET_RECV_BUFS + 8
+};
+
+// the directory the ShiftTables are cached in, a file per rank and
+// geometry, or null (the default) to always build them. a later table of
+// the same geometry maps its file rather than calling the layout functions,
+// which must be those it was built with
+void setShiftTableCache(const char* dir);
+
 struct InvTab { 
     int cb;
     int linearcb;
 };
 
+// T is the floating point type of the operator, see HalfSpinorT.
+// the buffers hold the half spinors of N sources per site and direction
+template <typename T, int N = 1>
 class ShiftTable {
 public:
+    using HalfSpinor = HalfSpinorBlockT<T, N>;
     
     ShiftTable(
         const int* _subgrid_size,
@@ -31,36 +77,138 @@ public:
         HalfSpinor* send_bufs[2][4],
         void (*getSiteCoords)(int coord[], int node, int linearsite), 
         int (*getLinearSiteIndex)(const int coord[]),
-        int (*getNodeNumber)(const int coord[])
+        int (*getNodeNumber)(const int coord[]),
+        SiteOrder order = SITE_ORDER_LEXICOGRAPHIC,
+        bool withNeighbours = false
         );
 
-    ~ShiftTable() {
-        free(xoffset_table);
-        free(xsite_table);
-    }
+    ~ShiftTable();
 
     inline
     int siteTable(int i) {
+        return sites_identity ? i : site_table[i];
+    }
+
+    // the QDP++ index of site i, also when the fields are in the order of
+    // the sweeps
+    inline int qdpSite(int i) {
         return site_table[i];
     }
 
+    // the fields are indexed in the order of the sweeps, siteTable is the
+    // identity
+    inline void setSweepOrderFields() {
+        sites_identity = true;
+    }
+
 
 
     HalfSpinor* halfspinorBufferOffset(HalfSpinorOffsetType type, int site, int mu) {
         //      std::cout << "type="<<type<<" site="<<site<<" mu="<<mu<<" index=" << (mu + 4*( site + subgrid_vol*(int)type)) << std::endl << std::flush;
-	return offset_table[mu + 4*( site + subgrid_vol*(int)type) ];
+        uint32_t offset = offset_table[mu + 4*( site + subgrid_vol*(int)type) ];
+	return offset_bases[offset >> OffsetIndexBits] + (offset & OffsetIndexMask);
+    }
+
+    // the coordinates c within the node (x not halved) of site idx of
+    // checkerboard cb, and of the next site in the order of the site table
+    inline void siteCoords(int cb, int idx, int c[4]) {
+        crtesn4d(idx - cb*subgrid_vol_cb, subgrid_cb_size, c);
+        c[0] = 2*c[0] + ((cb + c[1] + c[2] + c[3] + node_parity) & 1);
+    }
+
+    inline void nextSiteCoords(int cb, int c[4]) {
+        int xh = c[0]/2 + 1;
+        if (xh == subgrid_cb_size[0]) {
+            xh = 0;
+            for (int mu = 1; mu < 4 && ++c[mu] == subgrid_size[mu]; ++mu) {
+                c[mu] = 0;
+            }
+        }
+        c[0] = 2*xh + ((cb + c[1] + c[2] + c[3] + node_parity) & 1);
+    }
+
+    // the DECOMP_SCATTER or DECOMP_HVV_SCATTER entry of source site idx of
+    // checkerboard cb at coordinates c. on node neighbours are computed from
+    // c, only the faces (and all the sites of the other SiteOrders) read the
+    // offset table
+    inline HalfSpinor* scatterOffset(HalfSpinorOffsetType type, int cb, int idx,
+                                     const int c[4], int mu) {
+        if (!lexicographic) {
+            return halfspinorBufferOffset(type, idx, mu);
+        }
+        int n = c[mu] + (type == DECOMP_SCATTER ? -1 : 1);
+        if (n < 0 || n >= subgrid_size[mu]) {
+            if (split[mu]) {
+                return halfspinorBufferOffset(type, idx, mu);
+            }
+            n += n < 0 ? subgrid_size[mu] : -subgrid_size[mu];
+        }
+        int site = idx - cb*subgrid_vol_cb + subgrid_vol_cb*mu;
+        site += mu == 0 ? n/2 - c[0]/2 : (n - c[mu])*cb_stride[mu];
+        return offset_bases[type == DECOMP_SCATTER ? OFFSET_CHI1 : OFFSET_CHI2] + site;
+    }
+
+    // the RECONS_MVV_GATHER or RECONS_GATHER entry of target site
+    // idx = targetSite(cb, i). the classes that gather on node in all
+    // directions, the interior sites and for RECONS_GATHER the forward
+    // boundary ones, compute it rather than read the offset table
+    inline HalfSpinor* gatherOffset(HalfSpinorOffsetType type, int cb, int i, int idx, int mu) {
+        if (type == RECONS_MVV_GATHER
+            ? i < target_sites_begin[cb][FORWARD_BOUNDARY_SITES]
+            : i < target_sites_begin[cb][BOUNDARY_SITES]) {
+            return offset_bases[type == RECONS_MVV_GATHER ? OFFSET_CHI1 : OFFSET_CHI2]
+                + idx - cb*subgrid_vol_cb + subgrid_vol_cb*mu;
+        }
+        return halfspinorBufferOffset(type, idx, mu);
     }
 
     inline int subgridVolCB() {
         return subgrid_vol_cb;
     }
+
+    // target sites of checkerboard cb, ordered by TargetSiteClass
+    inline int targetSite(int cb, int i) {
+        return target_sites[cb][i];
+    }
+
+    inline int targetSitesBegin(TargetSiteClass c, int cb) {
+        return target_sites_begin[cb][c];
+    }
+
+    inline int numTargetSites(TargetSiteClass c, int cb) {
+        return target_sites_begin[cb][c+1] - target_sites_begin[cb][c];
+    }
+
+    // withNeighbours only: the site of the neighbour of site idx in
+    // direction mu, forward for k = mu and backward for k = 4 + mu, or -1
+    // when it is off node
+    inline int neighbour(int idx, int k) {
+        return neighbour_table[8*idx + k];
+    }
+
+    // withNeighbours only: the sites of checkerboard cb that scatter to a
+    // send buffer in some direction
+    inline int faceSite(int cb, int i) {
+        return face_sites[cb][i];
+    }
+
+    inline int numFaceSites(int cb) {
+        return face_sites[cb].size();
+    }
 private:
     /* Tables */
-    HalfSpinor** xoffset_table;        /* Unaligned */
-    HalfSpinor** offset_table;         /* Aligned */
+    uint32_t* xoffset_table;        /* Unaligned */
+    uint32_t* offset_table;         /* Aligned */
+    HalfSpinor* offset_bases[NUM_OFFSET_BASES];
     
     int *xsite_table;         /* Unaligned */
     int *site_table;          /* Aligned */
+
+    std::vector<int> target_sites[2];
+    int target_sites_begin[2][NUM_TARGET_SITE_CLASSES+1];
+
+    std::vector<int> neighbour_table;
+    std::vector<int> face_sites[2];
         
     int tot_size[4];          /* Class scope members */
     int subgrid_size[4];
@@ -68,6 +216,32 @@ private:
     int subgrid_vol;
     int subgrid_vol_cb;         /* Useful numbers */
     const int Nd;                   /* No of Dimensions */
+
+    /* For the neighbours without the offset table */
+    bool split[4];              /* the direction crosses nodes */
+    int cb_stride[4];           /* site index step in each direction */
+    int node_parity;            /* of the node's corner, sans x */
+    bool sites_identity;        /* the fields are in the order of the sweeps */
+
+    /* SiteOrder: the ordered index of each lexicographic cb index and the
+       inverse, empty when lexicographic */
+    bool lexicographic;
+    std::vector<int> site_order;
+    std::vector<int> site_order_inv;
+
+    void buildSiteOrder(SiteOrder order);
+
+    /* The cache file of setShiftTableCache. The site and offset tables of a
+       loaded one point into the mapping */
+    void* mapping;
+    size_t mapping_size;
+
+    std::string cacheFile(SiteOrder order, bool withNeighbours);
+    bool loadCache(const std::string& file, HalfSpinor* recv_bufs[2][4],
+                   HalfSpinor* send_bufs[2][4],
+                   int (*getLinearSiteIndex)(const int coord[]),
+                   SiteOrder order, bool withNeighbours);
+    void saveCache(const std::string& file, SiteOrder order, bool withNeighbours);
     
 
     // This is not needed as it can be done transitively:
@@ -89,7 +263,11 @@ private:
  
         cb=linearsite/subgrid_vol_cb;
       
-        crtesn4d(linearsite % subgrid_vol_cb, subgrid_cb_size, tmp_coord);
+        int lex = linearsite % subgrid_vol_cb;
+        if (!lexicographic) {
+            lex = site_order_inv[lex];
+        }
+        crtesn4d(lex, subgrid_cb_size, tmp_coord);
 
         // Add on position within the node
         // NOTE: the cb for the x-coord is not yet determined
@@ -125,7 +303,11 @@ private:
             subgrid_cb_coord[mu] = gcoords[mu] % subgrid_cb_size[mu];
         }
 
-        return localSite4d(subgrid_cb_coord, subgrid_cb_size) + cb*subgrid_vol_cb;
+        int lex = localSite4d(subgrid_cb_coord, subgrid_cb_size);
+        if (!lexicographic) {
+            lex = site_order[lex];
+        }
+        return lex + cb*subgrid_vol_cb;
     }
 
 
@@ -184,6 +366,12 @@ private:
         temp[mu] = (temp[mu] + isign + 2*tot_size[mu]) % tot_size[mu];
     } 
 
+    inline
+    uint32_t offsetCode(int base, int index)
+    {
+        return ((uint32_t)base << OffsetIndexBits) | (uint32_t)index;
+    }
+
     inline
     int parity(const int coord[])
     {
@@ -1,11 +1,65 @@
 #include "dslash_table.h"
 
+#include <cmath>
+#include <cstring>
+#include <type_traits>
+
+#include "neon_dslash_simd.h"
+
 namespace Chroma
 {
 
-QMP_mem_t* DslashTable::xchi = 0;
+namespace
+{
+// bytes on the wire for one face of nsites half spinors
+size_t wireSize(HaloCompression compression, int nsites)
+{
+    size_t size = nsites*12*sizeof(uint16_t);
+    if (compression == HALO_FP16_SCALED) {
+        size += nsites*sizeof(float);
+    }
+    return size;
+}
+
+// 4 reals of the comms buffers <-> 4 fp16 on the wire, times scale
+inline void packReals(uint16_t* dst, const float* src, float scale)
+{
+    Simd::vst_f16(dst, Simd::vmul(Simd::vld(src), Simd::vld_dup(&scale)));
+}
+
+inline void unpackReals(float* dst, const uint16_t* src, float scale)
+{
+    Simd::vst(dst, Simd::vmul(Simd::vld_f16(src), Simd::vld_dup(&scale)));
+}
+
+inline void packReals(uint16_t* dst, const double* src, float scale)
+{
+    for(int k=0; k < 4; k++) { 
+        dst[k] = Simd::float_to_half((float)src[k]*scale);
+    }
+}
+
+inline void unpackReals(double* dst, const uint16_t* src, float scale)
+{
+    for(int k=0; k < 4; k++) { 
+        dst[k] = (double)(Simd::half_to_float(src[k])*scale);
+    }
+}
+
+// fp16 comms buffers (DSLASH_HALF_CHI) are never compressed again
+inline void packReals(uint16_t* dst, const uint16_t* src, float)
+{
+    std::memcpy(dst, src, 4*sizeof(uint16_t));
+}
+
+inline void unpackReals(uint16_t* dst, const uint16_t* src, float)
+{
+    std::memcpy(dst, src, 4*sizeof(uint16_t));
+}
+}
 
-DslashTable::~DslashTable()
+template <typename T, int N>
+DslashTable<T, N>::~DslashTable()
 {
     /* Memory/comms handles */
     if (total_comm > 0) {
@@ -24,21 +78,28 @@ DslashTable::~DslashTable()
 	
     }
       
-    /* Free all space - 4 spinors and actual comms buffers  */
-    /* Simon: we have no mechanism to check if there are still other
-     * instances using our static xchi, so we do not free it. Typically
-     * it is used till the end of the program anyways */
-      
-    /* Free the shift table itself */
+    if (xwire != 0) {
+        QMP_free_memory(xwire);
+    }
+
+    if (xtmp != 0) {
+        QMP_free_memory(xtmp);
+    }
+
+    /* Free all space - 4 spinors and actual comms buffers. The operators
+       of one geometry share the table instead of these */
+    QMP_free_memory(xchi);
 }
 
-DslashTable::DslashTable(int subgrid[]) 
+template <typename T, int N>
+DslashTable<T, N>::DslashTable(int subgrid[], HaloCompression compression, const int faceBlocks[]) 
+    : xtmp(0), spinor_tmp(0), halo_compression(compression), xwire(0)
 {
     struct BufTable { 
 	unsigned int dir;
-	unsigned int offset;
-	unsigned int size;
-	unsigned int pad;
+	size_t offset;
+	size_t size;
+	size_t pad;
     };
 
     /* Get the dimensions of the machine */
@@ -60,13 +121,20 @@ DslashTable::DslashTable(int subgrid[])
     nbound[1]=(sx*sz*st)/2;
     nbound[2]=(sx*sy*st)/2;
     nbound[3]=(sx*sy*sz)/2;
+
+    /* Half spinors per face site */
+    int blocks[4];
+    for(int mu=0; mu < 4; mu++) { 
+        blocks[mu] = faceBlocks != 0 ? faceBlocks[mu] : N;
+    }
     int subgrid_vol_cb = sx*sy*sz*st/2;
-    int subgrid_vol = sx*sy*sz*st;
+    subgrid_vol = sx*sy*sz*st;
     BufTable recv[2][4];
 
-    int offset = 0;
+    /* The buffers grow with N: byte counts in size_t */
+    size_t offset = 0;
     int num=0;
-    int pad;
+    size_t pad;
       
     for(int i=0; i < 2; i++) { 
 
@@ -79,7 +147,7 @@ DslashTable::DslashTable(int subgrid[])
 	    
                 recv[i][num].dir = mu;
                 recv[i][num].offset = offset;
-                recv[i][num].size = nbound[mu]*sizeof(HalfSpinor);
+                recv[i][num].size = nbound[mu]*blocks[mu]*sizeof(HalfSpinorT<T>);
 	    
 	    
                 /* Cache line align the next buffer */
@@ -114,19 +182,17 @@ DslashTable::DslashTable(int subgrid[])
        This is the size of one of the Chi-s either forward or backward.
        The factor of 4 is the 4 Mu directions
        The second factor of 4 is for the 4 types.*/
-    int chisize = sizeof(HalfSpinor)*subgrid_vol_cb*4*4;
+    size_t chisize = sizeof(HalfSpinor)*subgrid_vol_cb*4*4;
       
     /* Total amount: 2 x offset -- for the comms.
        2 x chisize -- for the half spinor temps (2 cb's)
        10*CacheCacheLine - 5 lines of padding between
        comms bufs and chi1, and chi1 and chi2 */
-    int total_allocate = 2*chisize+2*offset+10*Cache::CacheLineSize;
+    size_t total_allocate = 2*chisize+2*offset+10*Cache::CacheLineSize;
       
-    if(xchi == 0) {
-        if ((xchi = QMP_allocate_aligned_memory(total_allocate,Cache::CacheSetSize,0)) == 0) {
-            QMP_error("init_wnxtsu3dslash: could not initialize xchi1");
-            QMP_abort(1);
-        }
+    if ((xchi = QMP_allocate_aligned_memory(total_allocate,Cache::CacheSetSize,0)) == 0) {
+        QMP_error("init_wnxtsu3dslash: could not initialize xchi1");
+        QMP_abort(1);
     }
       
     /* Get the aligned pointer out. This is the start of our memory */
@@ -158,11 +224,61 @@ DslashTable::DslashTable(int subgrid[])
     }
     chi2 = (HalfSpinor *)((unsigned char *)chi1 + chisize+pad);
       
+    /* The half spinors are fp16 already */
+    if (std::is_same<HalfSpinorReal, uint16_t>::value) { 
+        halo_compression = HALO_UNCOMPRESSED;
+    }
+
+    /* Compressed halos: the kernels still fill and read the comms buffers
+       above, which get packed into / unpacked from separate wire buffers */
+    size_t wire_size[2][4] = {};
+    if (halo_compression != HALO_UNCOMPRESSED && num > 0) {
+        size_t wire_offset[2][4];
+        size_t wire_total = 0;
+
+        for(int i=0; i < 2; i++) { 
+            for(int mu=0; mu < num; mu++) { 
+                face_sites[i][mu] = nbound[recv[i][mu].dir]*blocks[recv[i][mu].dir];
+                wire_size[i][mu] = wireSize(halo_compression, face_sites[i][mu]);
+                wire_offset[i][mu] = wire_total;
+
+                /* Cache line align the next buffer */
+                wire_total += wire_size[i][mu];
+                if ( (wire_total % Cache::CacheLineSize) != 0 ) { 
+                    wire_total += Cache::CacheLineSize - (wire_total % Cache::CacheLineSize);
+                }
+            }
+        }
+
+        /* First half for sending, second half for receiving */
+        if ((xwire = QMP_allocate_aligned_memory(2*wire_total,Cache::CacheLineSize,0)) == 0) {
+            QMP_error("DslashTable: could not allocate the halo wire buffers");
+            QMP_abort(1);
+        }
+        unsigned char* wire = (unsigned char *)QMP_get_memory_pointer(xwire);
+
+        for(int i=0; i < 2; i++) { 
+            for(int mu=0; mu < num; mu++) { 
+                send_wire[i][mu] = wire + wire_offset[i][mu];
+                recv_wire[i][mu] = wire + wire_total + wire_offset[i][mu];
+            }
+        }
+    }
+    else { 
+        halo_compression = HALO_UNCOMPRESSED;
+    }
+
     /* Now we can set up the QMP isms... */
     for(int i=0; i < 2; i++) { 
 	for(int mu=0; mu < num; mu++) { 
-            recv_msg[i][mu] = QMP_declare_msgmem(recv_bufptr[i][mu], recv[i][mu].size);
-            send_msg[i][mu] = QMP_declare_msgmem(send_bufptr[i][mu], recv[i][mu].size);
+            if (halo_compression != HALO_UNCOMPRESSED) { 
+                recv_msg[i][mu] = QMP_declare_msgmem(recv_wire[i][mu], wire_size[i][mu]);
+                send_msg[i][mu] = QMP_declare_msgmem(send_wire[i][mu], wire_size[i][mu]);
+            }
+            else { 
+                recv_msg[i][mu] = QMP_declare_msgmem(recv_bufptr[i][mu], recv[i][mu].size);
+                send_msg[i][mu] = QMP_declare_msgmem(send_bufptr[i][mu], recv[i][mu].size);
+            }
             if( i == 0 ) { 
                 /* Recv from forward, send backward pair */
                 recv_mh[i][mu]= QMP_declare_receive_relative(recv_msg[i][mu], recv[i][mu].dir, +1, 0);
@@ -187,4 +303,104 @@ DslashTable::DslashTable(int subgrid[])
     total_comm = num;
 }
 
+template <typename T, int N>
+SpinorT<T>* DslashTable<T, N>::getSpinorTmp()
+{
+    if (xtmp == 0) {
+        if ((xtmp = QMP_allocate_aligned_memory(N*subgrid_vol*sizeof(SpinorT<T>),Cache::CacheSetSize,0)) == 0) {
+            QMP_error("DslashTable: could not allocate the spinor temporaries");
+            QMP_abort(1);
+        }
+        spinor_tmp = (SpinorT<T>*)QMP_get_memory_pointer(xtmp);
+    }
+    return spinor_tmp;
+}
+
+template <typename T, int N>
+void DslashTable<T, N>::packHalo(int i)
+{
+    for(int mu=0; mu < total_comm; mu++) { 
+        const HalfSpinorReal* src = (const HalfSpinorReal*)send_bufptr[i][mu];
+        int nsites = face_sites[i][mu];
+
+        if (halo_compression == HALO_FP16) { 
+            uint16_t* dst = (uint16_t*)send_wire[i][mu];
+
+#pragma omp parallel for
+            for(int site=0; site < nsites; site++) { 
+                for(int k=0; k < 3; k++) { 
+                    packReals(dst + 12*site + 4*k, src + 12*site + 4*k, 1);
+                }
+            }
+        }
+        else { 
+            /* [ nsites float scales ][ nsites fp16 half spinors ] */
+            float* scales = (float*)send_wire[i][mu];
+            uint16_t* dst = (uint16_t*)(send_wire[i][mu] + nsites*sizeof(float));
+
+#pragma omp parallel for
+            for(int site=0; site < nsites; site++) { 
+                float scale = 0;
+                for(int k=0; k < 12; k++) { 
+                    scale = std::fmax(scale, std::fabs((float)src[12*site + k]));
+                }
+                float inv = scale > 0 ? 1/scale : 0;
+                scales[site] = scale;
+
+                for(int k=0; k < 3; k++) { 
+                    packReals(dst + 12*site + 4*k, src + 12*site + 4*k, inv);
+                }
+            }
+        }
+    }
+}
+
+template <typename T, int N>
+void DslashTable<T, N>::unpackHalo(int i)
+{
+    for(int mu=0; mu < total_comm; mu++) { 
+        HalfSpinorReal* dst = (HalfSpinorReal*)recv_bufptr[i][mu];
+        int nsites = face_sites[i][mu];
+
+        if (halo_compression == HALO_FP16) { 
+            const uint16_t* src = (const uint16_t*)recv_wire[i][mu];
+
+#pragma omp parallel for
+            for(int site=0; site < nsites; site++) { 
+                for(int k=0; k < 3; k++) { 
+                    unpackReals(dst + 12*site + 4*k, src + 12*site + 4*k, 1);
+                }
+            }
+        }
+        else { 
+            const float* scales = (const float*)recv_wire[i][mu];
+            const uint16_t* src = (const uint16_t*)(recv_wire[i][mu] + nsites*sizeof(float));
+
+#pragma omp parallel for
+            for(int site=0; site < nsites; site++) { 
+                for(int k=0; k < 3; k++) { 
+                    unpackReals(dst + 12*site + 4*k, src + 12*site + 4*k, scales[site]);
+                }
+            }
+        }
+    }
+}
+
+template class DslashTable<float, 1>;
+template class DslashTable<float, 2>;
+template class DslashTable<float, 4>;
+template class DslashTable<float, 8>;
+template class DslashTable<float, 12>;
+template class DslashTable<float, 16>;
+template class DslashTable<float, 20>;
+template class DslashTable<float, 24>;
+template class DslashTable<double, 1>;
+template class DslashTable<double, 2>;
+template class DslashTable<double, 4>;
+template class DslashTable<double, 8>;
+template class DslashTable<double, 12>;
+template class DslashTable<double, 16>;
+template class DslashTable<double, 20>;
+template class DslashTable<double, 24>;
+
 } // namespace Chroma
@@ -1,4 +1,9 @@
 #include <omp.h>
+#include <array>
+#include <cstring>
+#include <tuple>
+#include <utility>
+#include <vector>
 
 #include "neon_dslash.h"
 #include "neon_dslash_impl.h"
@@ -8,154 +13,610 @@ namespace Chroma
 
 
 // Func should be stateless
-template <typename Func>
+// Threads split the site range [first, first + nsites)
+template <typename Func, typename T, int N>
 void dispatchToThreads(Func func,
-                       Spinor* spinorField, HalfSpinor* theHalfSpinor,
-                       GaugeMat (*gaugeField)[4],
-                       ShiftTable* stab, int cb, int const nsites)
+                       SpinorT<T>* const* spinorField, HalfSpinorBlockT<T, N>* theHalfSpinor,
+                       PackedGaugeT<T> (*gaugeField)[4],
+                       SweepEpilogueT<T> const* ep,
+                       ShiftTable<T, N>* stab, int cb, int const nsites,
+                       int const first = 0)
 {
     int nthreads;
     int id;
     int low;
     int high;
 
-#pragma omp parallel shared(func, spinorField, theHalfSpinor, gaugeField, cb, stab) \
+#pragma omp parallel shared(func, spinorField, theHalfSpinor, gaugeField, ep, cb, stab, nsites, first) \
     private(id, nthreads, low, high) default(none)
     {
         nthreads = omp_get_num_threads();
         id = omp_get_thread_num();
-        low = nsites * id / nthreads;
-        high = nsites * (id+1) / nthreads;
-        func(low, high, id, spinorField, theHalfSpinor, gaugeField, cb, stab);
+        low = first + nsites * id / nthreads;
+        high = first + nsites * (id+1) / nthreads;
+        func(low, high, id, spinorField, theHalfSpinor, gaugeField, cb, stab, ep);
+    }
+}
+
+// Func should be stateless, like dispatchToThreads for the gather sweeps
+template <typename Func, typename T, int N>
+void dispatchGather(Func func,
+                    SpinorT<T>* const* spinorField, SpinorT<T>* const* sourceField,
+                    PackedGaugeT<T> (*gaugeField)[8],
+                    SweepEpilogueT<T> const* ep,
+                    ShiftTable<T, N>* stab, int cb, int const nsites,
+                    int const first = 0)
+{
+    int nthreads;
+    int id;
+    int low;
+    int high;
+
+#pragma omp parallel shared(func, spinorField, sourceField, gaugeField, ep, cb, stab, nsites, first) \
+    private(id, nthreads, low, high) default(none)
+    {
+        nthreads = omp_get_num_threads();
+        id = omp_get_thread_num();
+        low = first + nsites * id / nthreads;
+        high = first + nsites * (id+1) / nthreads;
+        func(low, high, id, spinorField, sourceField, gaugeField, cb, stab, ep);
+    }
+}
+
+// the partial sums of the threads to red
+template <int N, typename Reduction>
+void reduceSums(std::vector<double> const& partial, Reduction& red)
+{
+    for (int r = 0; r < N; ++r) {
+        red.norm2[r] = 0;
+        red.dot[r][0] = 0;
+        red.dot[r][1] = 0;
+    }
+    for (size_t t = 0; t < partial.size(); t += sweepSumStride<N>()) {
+        for (int r = 0; r < N; ++r) {
+            red.norm2[r] += partial[t + 3*r];
+            red.dot[r][0] += partial[t + 3*r + 1];
+            red.dot[r][1] += partial[t + 3*r + 2];
+        }
+    }
+    if (red.global) {
+        QMP_sum_double_array(red.norm2, N);
+        QMP_sum_double_array(&red.dot[0][0], 2*N);
+    }
+}
+
+// the table of key, built by build() unless an operator still holds one.
+// process wide, the tables go when their last operator does. create runs
+// on the master thread, so no locking
+template <typename Table, typename Key, typename Build>
+std::shared_ptr<Table> sharedTable(Key const& key, Build build)
+{
+    static std::vector<std::pair<Key, std::weak_ptr<Table>>> tables;
+
+    std::shared_ptr<Table> table;
+    for (size_t i = 0; i < tables.size();) {
+        if (tables[i].second.expired()) {
+            tables.erase(tables.begin() + i);
+        } else {
+            if (tables[i].first == key) {
+                table = tables[i].second.lock();
+            }
+            ++i;
+        }
+    }
+    if (!table) {
+        table.reset(build());
+        tables.emplace_back(key, table);
+    }
+    return table;
+}
+
+// the sites of a field of bytes per site between the QDP++ order of src
+// and the order of the sweeps of dst, or back for export
+template <typename T, int N>
+void permuteSites(void* dst, const void* src, size_t bytes,
+                  ShiftTable<T, N>* stab, bool export_)
+{
+    unsigned char* d = (unsigned char*) dst;
+    const unsigned char* s = (const unsigned char*) src;
+    int vol = 2*stab->subgridVolCB();
+
+#pragma omp parallel for
+    for (int i = 0; i < vol; ++i) {
+        int site = stab->qdpSite(i);
+        if (export_) {
+            std::memcpy(d + site*bytes, s + i*bytes, bytes);
+        } else {
+            std::memcpy(d + i*bytes, s + site*bytes, bytes);
+        }
     }
 }
 
 //! Full constructor with general coefficients
-void NeonDslash::create(int subgrid[], /* int subgrid[4] */
-                        GaugeMat* gauge,
-                        void (*getSiteCoords)(int coord[], int node, int linear),
-                        int (*getLinearSiteIndex)(const int coord[]),
-                        int (*nodeNumber)(const int coord[]))
+template <typename T, int N>
+void NeonDslashT<T, N>::create(int subgrid[], /* int subgrid[4] */
+                               PackedGauge* gauge,
+                               void (*getSiteCoords)(int coord[], int node, int linear),
+                               int (*getLinearSiteIndex)(const int coord[]),
+                               int (*nodeNumber)(const int coord[]),
+                               HaloCompression haloCompression,
+                               SiteOrder siteOrder,
+                               FieldLayout fieldLayout,
+                               GaugeLayout gaugeLayout)
 {
     packedGauge = gauge;
-    
-    dslashTable.reset(new DslashTable(subgrid));
-    shiftTable.reset(new ShiftTable(subgrid,
-                                    dslashTable->getChi1(),
-                                    dslashTable->getChi2(), 
-                                    (HalfSpinor*(*)[4])(dslashTable->getRecvBufptr()),
-                                    (HalfSpinor*(*)[4])(dslashTable->getSendBufptr()),
-                                    getSiteCoords,
-                                    getLinearSiteIndex,
-                                    nodeNumber
-                         ));
-}
-
-void NeonDslash::apply(float* chi, float* psiArg, int isign, int cb) const
-{
-    GaugeMat (*u)[4] = (GaugeMat(*)[4]) &packedGauge[0];
-    Spinor* psi = (Spinor*) psiArg;
-    Spinor* res = (Spinor*) chi;
+
+    // drop ours first, a table is rebuilt rather than shared when we held
+    // the last reference
+    shiftTable.reset();
+    dslashTable.reset();
+
+    std::array<int, 4> extents = {{subgrid[0], subgrid[1], subgrid[2], subgrid[3]}};
+    bool withNeighbours = gaugeLayout == GAUGE_DOUBLE_STORED;
+    bool sweepOrderFields = fieldLayout == FIELD_LAYOUT_INTERNAL;
+
+    dslashTable = sharedTable<DslashTable<T, N>>(
+        std::make_tuple(extents, haloCompression),
+        [&]() { return new DslashTable<T, N>(subgrid, haloCompression); });
+
+    // the comms buffers stand for the DslashTable, it outlives the
+    // ShiftTables pointing into them
+    DslashTable<T, N>* dtab = dslashTable.get();
+    shiftTable = sharedTable<ShiftTable<T, N>>(
+        std::make_tuple(extents, dtab->getChi1(), getSiteCoords, getLinearSiteIndex, nodeNumber,
+                        siteOrder, withNeighbours, sweepOrderFields),
+        [&]() {
+            ShiftTable<T, N>* stab = new ShiftTable<T, N>(subgrid,
+                                                          dtab->getChi1(),
+                                                          dtab->getChi2(),
+                                                          (HalfSpinor*(*)[4])(dtab->getRecvBufptr()),
+                                                          (HalfSpinor*(*)[4])(dtab->getSendBufptr()),
+                                                          getSiteCoords,
+                                                          getLinearSiteIndex,
+                                                          nodeNumber,
+                                                          siteOrder,
+                                                          withNeighbours);
+            if (sweepOrderFields) {
+                stab->setSweepOrderFields();
+            }
+            return stab;
+        });
+
+    if (xgauge != 0) {
+        QMP_free_memory(xgauge);
+        xgauge = 0;
+    }
+    if (xgauge8 != 0) {
+        QMP_free_memory(xgauge8);
+        xgauge8 = 0;
+    }
+    if (gaugeLayout == GAUGE_DOUBLE_STORED) {
+        int vol = 2*shiftTable->subgridVolCB();
+        if ((xgauge8 = QMP_allocate_aligned_memory(vol*sizeof(PackedGauge[8]), Cache::CacheLineSize, 0)) == 0) {
+            QMP_error("NeonDslash: could not allocate the double stored gauge field");
+            QMP_abort(1);
+        }
+    }
+    if (fieldLayout == FIELD_LAYOUT_INTERNAL) {
+        int vol = 2*shiftTable->subgridVolCB();
+        if ((xgauge = QMP_allocate_aligned_memory(vol*sizeof(PackedGauge[4]), Cache::CacheLineSize, 0)) == 0) {
+            QMP_error("NeonDslash: could not allocate the gauge field");
+            QMP_abort(1);
+        }
+        packedGauge = (PackedGauge*) QMP_get_memory_pointer(xgauge);
+        permuteSites(packedGauge, gauge, sizeof(PackedGauge[4]), shiftTable.get(), false);
+    }
+    if (xgauge8 != 0) {
+        doubleStoreGauge();
+    }
+}
+
+template <typename T, int N>
+void NeonDslashT<T, N>::importGauge(const PackedGauge* gauge)
+{
+    if (xgauge == 0 && xgauge8 == 0) {
+        QMP_error("NeonDslash: importGauge needs FIELD_LAYOUT_INTERNAL or GAUGE_DOUBLE_STORED");
+        QMP_abort(1);
+    }
+    if (xgauge != 0) {
+        permuteSites(packedGauge, gauge, sizeof(PackedGauge[4]), shiftTable.get(), false);
+    } else {
+        packedGauge = (PackedGauge*) gauge;
+    }
+    if (xgauge8 != 0) {
+        doubleStoreGauge();
+    }
+}
+
+// the links of each site followed by those of its backward neighbours,
+// indexed like the other fields. the backward links of the sites on the
+// lower faces come with the halos and are left alone
+template <typename T, int N>
+void NeonDslashT<T, N>::doubleStoreGauge()
+{
+    PackedGauge (*u)[4] = (PackedGauge(*)[4]) &packedGauge[0];
+    PackedGauge (*u8)[8] = (PackedGauge(*)[8]) QMP_get_memory_pointer(xgauge8);
+    ShiftTable<T, N>* stab = shiftTable.get();
+    int vol = 2*stab->subgridVolCB();
+
+#pragma omp parallel for
+    for (int idx = 0; idx < vol; ++idx) {
+        int site = stab->siteTable(idx);
+        for (int mu = 0; mu < 4; ++mu) {
+            std::memcpy(&u8[site][mu], &u[site][mu], sizeof(PackedGauge));
+            int nb = stab->neighbour(idx, 4 + mu);
+            if (nb >= 0) {
+                std::memcpy(&u8[site][4 + mu], &u[stab->siteTable(nb)][mu], sizeof(PackedGauge));
+            }
+        }
+    }
+}
+
+template <typename T, int N>
+void NeonDslashT<T, N>::importSpinor(T* internal, const T* psi) const
+{
+    permuteSites(internal, psi, sizeof(Spinor), shiftTable.get(), false);
+}
+
+template <typename T, int N>
+void NeonDslashT<T, N>::exportSpinor(T* psi, const T* internal) const
+{
+    permuteSites(psi, internal, sizeof(Spinor), shiftTable.get(), true);
+}
+
+template <typename T, int N>
+void NeonDslashT<T, N>::importClover(PackedClover* internal, const PackedClover* clover) const
+{
+    permuteSites(internal, clover, sizeof(PackedClover), shiftTable.get(), false);
+}
+
+template <typename T, int N>
+void NeonDslashT<T, N>::apply(T* const chi[], T* const psi[], int isign, int cb) const
+{
+    applyFused(chi, psi, isign, cb, SweepEpilogue{});
+}
+
+template <typename T, int N>
+void NeonDslashT<T, N>::apply(T* const chi[], T* const psi[], int isign, int cb,
+                              Reduction& red) const
+{
+    applyFused(chi, psi, isign, cb, SweepEpilogue{}, &red);
+}
+
+template <typename T, int N>
+void NeonDslashT<T, N>::applyAxpby(T* const chi[], T a, T* const xArg[], T b,
+                                   T* const psi[], int isign, int cb) const
+{
+    Spinor* x[N];
+    for (int r = 0; r < N; ++r) {
+        x[r] = (Spinor*) xArg[r];
+    }
+    SweepEpilogue ep{};
+    ep.x = x;
+    ep.a = a;
+    ep.b = b;
+    applyFused(chi, psi, isign, cb, ep);
+}
+
+template <typename T, int N>
+void NeonDslashT<T, N>::applySchur(T* const chi[], T* const psi[], T kappa,
+                                   int isign, int cb) const
+{
+    applySchurFused(chi, psi, kappa, isign, cb, SweepEpilogue{}, SweepEpilogue{}, 0);
+}
+
+template <typename T, int N>
+void NeonDslashT<T, N>::applySchur(T* const chi[], T* const psi[], T kappa,
+                                   int isign, int cb, Reduction& red) const
+{
+    applySchurFused(chi, psi, kappa, isign, cb, SweepEpilogue{}, SweepEpilogue{}, &red);
+}
+
+template <typename T, int N>
+void NeonDslashT<T, N>::applySchurFused(T* const chi[], T* const psi[], T kappa,
+                                        int isign, int cb,
+                                        SweepEpilogue const& hop, SweepEpilogue last,
+                                        Reduction* red) const
+{
+    Spinor* tmpField = dslashTable->getSpinorTmp();
+    int subgrid_vol = 2*shiftTable->subgridVolCB();
+
+    T* tmp[N];
+    Spinor* x[N];
+    for (int r = 0; r < N; ++r) {
+        tmp[r] = (T*) &tmpField[r*subgrid_vol];
+        x[r] = (Spinor*) psi[r];
+    }
+
+    // the same halo buffers serve both hops, the first one's sends are
+    // finished when it returns
+    last.x = x;
+    last.a = 1;
+    last.b = -kappa*kappa;
+    applyFused(tmp, psi, isign, 1 - cb, hop);
+    applyFused(chi, tmp, isign, cb, last, red);
+}
+
+template <typename T, int N>
+void NeonDslashT<T, N>::applyFused(T* const chi[], T* const psiArg[], int isign, int cb,
+                                   SweepEpilogue const& epArg, Reduction* red) const
+{
+    SweepEpilogue ep = epArg;
+    ep.streaming = streamingStores;
+    Spinor* y[N];
+    std::vector<double> partial;
+    if (red != 0) {
+        for (int r = 0; r < N; ++r) {
+            y[r] = (Spinor*) (red->y == 0 ? 0 : red->y[r]);
+        }
+        partial.assign(omp_get_max_threads()*sweepSumStride<N>(), 0);
+        ep.y = red->y == 0 ? 0 : y;
+        ep.sums = partial.data();
+    }
+
+    PackedGauge (*u)[4] = (PackedGauge(*)[4]) &packedGauge[0];
+    Spinor* psi[N];
+    Spinor* res[N];
+    for (int r = 0; r < N; ++r) {
+        psi[r] = (Spinor*) psiArg[r];
+        res[r] = (Spinor*) chi[r];
+    }
     
     HalfSpinor* chi1 = dslashTable->getChi1();
     HalfSpinor* chi2 = dslashTable->getChi2();
     int subgrid_vol_cb = shiftTable->subgridVolCB();
 
     int sourceCB = 1 - cb;
-    
-    if (isign == 1) {
+    int targetCB = cb;
+
+    PackedGauge (*u8)[8] = xgauge8 == 0 ? 0 : (PackedGauge(*)[8]) QMP_get_memory_pointer(xgauge8);
+    bool gather = u8 != 0 && (ep.fifth == 0 || ep.fifth->dagger);
+
+    if (gather && (isign == 1 || isign == -1)) {
 
         dslashTable->startReceives();
-        
-        dispatchToThreads(decomp_plus,
+
+        dispatchToThreads(isign == 1 ? decomp_face_plus<T, N> : decomp_face_minus<T, N>,
                           psi,
                           chi1,
                           u,
+                          &ep,
                           shiftTable.get(),
                           sourceCB,
-                          subgrid_vol_cb);
+                          shiftTable->numFaceSites(sourceCB));
+
+        dslashTable->startSends();
+
+        auto sweep = isign == 1 ? gather_plus<T, N> : gather_minus<T, N>;
+
+        // interior sites need no halo data: overlap them with the comms
+        dispatchGather(sweep,
+                       res,
+                       psi,
+                       u8,
+                       &ep,
+                       shiftTable.get(),
+                       targetCB,
+                       shiftTable->numTargetSites(INTERIOR_SITES, targetCB),
+                       shiftTable->targetSitesBegin(INTERIOR_SITES, targetCB));
+
+        dslashTable->finishReceiveFromBack();
+
+        dispatchGather(sweep,
+                       res,
+                       psi,
+                       u8,
+                       &ep,
+                       shiftTable.get(),
+                       targetCB,
+                       shiftTable->numTargetSites(FORWARD_BOUNDARY_SITES, targetCB),
+                       shiftTable->targetSitesBegin(FORWARD_BOUNDARY_SITES, targetCB));
+
+        dslashTable->finishReceiveFromForward();
+
+        dispatchGather(sweep,
+                       res,
+                       psi,
+                       u8,
+                       &ep,
+                       shiftTable.get(),
+                       targetCB,
+                       shiftTable->numTargetSites(BOUNDARY_SITES, targetCB),
+                       shiftTable->targetSitesBegin(BOUNDARY_SITES, targetCB));
+
+        dslashTable->finishSends();
 
-        dslashTable->startSendForward(); 
-        dispatchToThreads(decomp_hvv_plus,
+    } else if (isign == 1) {
+
+        dslashTable->startReceives();
+        
+        dispatchToThreads(decomp_fused_plus<T, N>,
                           psi,
-                          chi2,
+                          chi1,
                           u,
+                          &ep,
                           shiftTable.get(),
                           sourceCB,
                           subgrid_vol_cb);
 
-        dslashTable->finishSendForward();
+        dslashTable->startSends();
+
+        // interior sites need no halo data: overlap them with the comms
+        dispatchToThreads(recons_fused_plus<T, N>,
+                          res,
+                          chi1,
+                          u,
+                          &ep,
+                          shiftTable.get(),
+                          targetCB,
+                          shiftTable->numTargetSites(INTERIOR_SITES, targetCB),
+                          shiftTable->targetSitesBegin(INTERIOR_SITES, targetCB));
+
         dslashTable->finishReceiveFromBack();
-        dslashTable->startSendBack();
 
-        dispatchToThreads(mvv_recons_plus,
+        dispatchToThreads(recons_fused_plus<T, N>,
                           res,
                           chi1,
                           u,
+                          &ep,
                           shiftTable.get(),
-                          1-sourceCB,
-                          subgrid_vol_cb);
+                          targetCB,
+                          shiftTable->numTargetSites(FORWARD_BOUNDARY_SITES, targetCB),
+                          shiftTable->targetSitesBegin(FORWARD_BOUNDARY_SITES, targetCB));
 
-        dslashTable->finishSendBack();
-        dslashTable->finishReceiveFromForward();    
+        dispatchToThreads(mvv_recons_plus<T, N>,
+                          res,
+                          chi1,
+                          u,
+                          &ep,
+                          shiftTable.get(),
+                          targetCB,
+                          shiftTable->numTargetSites(BOUNDARY_SITES, targetCB),
+                          shiftTable->targetSitesBegin(BOUNDARY_SITES, targetCB));
 
-        dispatchToThreads(recons_plus,
+        dslashTable->finishReceiveFromForward();
+
+        dispatchToThreads(recons_plus<T, N>,
                           res, 
                           chi2,
                           u,	
+                          &ep,
                           shiftTable.get(),
-                          1-sourceCB,
-                          subgrid_vol_cb);
+                          targetCB,
+                          shiftTable->numTargetSites(BOUNDARY_SITES, targetCB),
+                          shiftTable->targetSitesBegin(BOUNDARY_SITES, targetCB));
+
+        dslashTable->finishSends();
 
     } else if (isign == -1) {
-        
-        dslashTable->startReceives();
 
-        dispatchToThreads(decomp_minus,
+        dslashTable->startReceives();
+        
+        dispatchToThreads(decomp_fused_minus<T, N>,
                           psi,
                           chi1,
                           u,
+                          &ep,
                           shiftTable.get(),
                           sourceCB,
                           subgrid_vol_cb);
 
-        dslashTable->startSendForward(); 
-        dispatchToThreads(decomp_hvv_minus,
-                          psi,
-                          chi2,
+        dslashTable->startSends();
+
+        // interior sites need no halo data: overlap them with the comms
+        dispatchToThreads(recons_fused_minus<T, N>,
+                          res,
+                          chi1,
                           u,
+                          &ep,
                           shiftTable.get(),
-                          sourceCB,
-                          subgrid_vol_cb);
+                          targetCB,
+                          shiftTable->numTargetSites(INTERIOR_SITES, targetCB),
+                          shiftTable->targetSitesBegin(INTERIOR_SITES, targetCB));
 
-        dslashTable->finishSendForward();
         dslashTable->finishReceiveFromBack();
-        dslashTable->startSendBack();
 
-        dispatchToThreads(mvv_recons_minus,
+        dispatchToThreads(recons_fused_minus<T, N>,
                           res,
                           chi1,
                           u,
+                          &ep,
                           shiftTable.get(),
-                          1-sourceCB,
-                          subgrid_vol_cb);
+                          targetCB,
+                          shiftTable->numTargetSites(FORWARD_BOUNDARY_SITES, targetCB),
+                          shiftTable->targetSitesBegin(FORWARD_BOUNDARY_SITES, targetCB));
+
+        dispatchToThreads(mvv_recons_minus<T, N>,
+                          res,
+                          chi1,
+                          u,
+                          &ep,
+                          shiftTable.get(),
+                          targetCB,
+                          shiftTable->numTargetSites(BOUNDARY_SITES, targetCB),
+                          shiftTable->targetSitesBegin(BOUNDARY_SITES, targetCB));
 
-        dslashTable->finishSendBack();
         dslashTable->finishReceiveFromForward();
 
-        dispatchToThreads(recons_minus,
+        dispatchToThreads(recons_minus<T, N>,
                           res, 
                           chi2,
                           u,	
+                          &ep,
                           shiftTable.get(),
-                          1-sourceCB,
-                          subgrid_vol_cb);
+                          targetCB,
+                          shiftTable->numTargetSites(BOUNDARY_SITES, targetCB),
+                          shiftTable->targetSitesBegin(BOUNDARY_SITES, targetCB));
+
+        dslashTable->finishSends();
     } else {
         // not possible
         throw 0;
     }
+
+    if (red != 0) {
+        reduceSums<N>(partial, *red);
+    }
 }
 
 
 
+// apply(T* chi, T* psi) only exists for N = 1, so no class instantiation
+#define INSTANTIATE_DSLASH(T, N)                                                   \
+    template void NeonDslashT<T, N>::create(int subgrid[],                        \
+                                            PackedGaugeT<T>* gauge,                \
+                                            void (*)(int coord[], int, int),       \
+                                            int (*)(const int coord[]),            \
+                                            int (*)(const int coord[]),            \
+                                            HaloCompression, SiteOrder,            \
+                                            FieldLayout, GaugeLayout);             \
+    template void NeonDslashT<T, N>::importGauge(const PackedGaugeT<T>* gauge);   \
+    template void NeonDslashT<T, N>::importSpinor(T* internal,                   \
+                                                  const T* psi) const;           \
+    template void NeonDslashT<T, N>::exportSpinor(T* psi,                        \
+                                                  const T* internal) const;      \
+    template void NeonDslashT<T, N>::importClover(PackedCloverT<T>* internal,    \
+                                                  const PackedCloverT<T>* clover) const; \
+    template void NeonDslashT<T, N>::apply(T* const chi[], T* const psi[],        \
+                                           int isign, int cb) const;              \
+    template void NeonDslashT<T, N>::apply(T* const chi[], T* const psi[],        \
+                                           int isign, int cb,                    \
+                                           Reduction& red) const;                \
+    template void NeonDslashT<T, N>::applyAxpby(T* const chi[], T a,              \
+                                                T* const x[], T b,               \
+                                                T* const psi[],                  \
+                                                int isign, int cb) const;        \
+    template void NeonDslashT<T, N>::applySchur(T* const chi[], T* const psi[],   \
+                                                T kappa, int isign, int cb) const; \
+    template void NeonDslashT<T, N>::applySchur(T* const chi[], T* const psi[],   \
+                                                T kappa, int isign, int cb,      \
+                                                Reduction& red) const;           \
+    template void NeonDslashT<T, N>::applyFused(T* const chi[], T* const psi[],   \
+                                                int isign, int cb,               \
+                                                SweepEpilogueT<T> const& ep,     \
+                                                Reduction* red) const;           \
+    template void NeonDslashT<T, N>::applySchurFused(T* const chi[],             \
+                                                     T* const psi[], T kappa,    \
+                                                     int isign, int cb,          \
+                                                     SweepEpilogueT<T> const& hop, \
+                                                     SweepEpilogueT<T> last,     \
+                                                     Reduction* red) const;
+
+INSTANTIATE_DSLASH(float, 1)
+INSTANTIATE_DSLASH(float, 2)
+INSTANTIATE_DSLASH(float, 4)
+INSTANTIATE_DSLASH(float, 8)
+INSTANTIATE_DSLASH(float, 12)
+INSTANTIATE_DSLASH(float, 16)
+INSTANTIATE_DSLASH(float, 20)
+INSTANTIATE_DSLASH(float, 24)
+INSTANTIATE_DSLASH(double, 1)
+INSTANTIATE_DSLASH(double, 2)
+INSTANTIATE_DSLASH(double, 4)
+INSTANTIATE_DSLASH(double, 8)
+INSTANTIATE_DSLASH(double, 12)
+INSTANTIATE_DSLASH(double, 16)
+INSTANTIATE_DSLASH(double, 20)
+INSTANTIATE_DSLASH(double, 24)
+
 } // namespace Chroma
@@ -3,287 +3,796 @@
 #include <tuple>
 
 #include "neon_dslash_details.h"
+#include "neon_dslash_gauge.h"
 
 namespace Chroma
 {
 
-// spinProjectDirMinus()
-void decomp_plus(int lo, int hi, int id,
-                 Spinor* spinorField, HalfSpinor* chi,
-                 GaugeMat (*gauge)[4], int cb,
-                 ShiftTable* sTab)
+namespace
 {
-    int subgridVolCB = sTab->subgridVolCB();
-    int low = subgridVolCB * cb + lo;
-    int high = subgridVolCB * cb + hi;
-    
-    HalfSpinor* s3;
-    HalfSpinor* s4;
-    HalfSpinor* s5;
-    HalfSpinor* s6;
-
-    Spinor* sp;
-
-    for (int idx = low; idx < high; ++idx) {
-        int curSite = sTab->siteTable(idx);
-        s3 = sTab->halfspinorBufferOffset(DECOMP_SCATTER, idx, 0);
-        s4 = sTab->halfspinorBufferOffset(DECOMP_SCATTER, idx, 1);
-        s5 = sTab->halfspinorBufferOffset(DECOMP_SCATTER, idx, 2);
-        s6 = sTab->halfspinorBufferOffset(DECOMP_SCATTER, idx, 3);
-        sp = &spinorField[curSite];
-
-        decomp_gamma0_minus(*sp, *s3);
-        decomp_gamma1_minus(*sp, *s4);
-        decomp_gamma2_minus(*sp, *s5);
-        decomp_gamma3_minus(*sp, *s6);
+// what the decomp sweeps touch at source site idx of checkerboard cb at
+// coordinates c. streamed scatter targets are not prefetched: that would
+// bring back the line allocation the non-temporal stores avoid
+template <typename T, int N>
+inline void prefetch_decomp(int cb, int idx, const int c[4], SpinorT<T>* const* spinorFields,
+                            PackedGaugeT<T> (*gaugeField)[4], ShiftTable<T, N>* sTab,
+                            bool stream)
+{
+    int site = sTab->siteTable(idx);
+    prefetch_lines<0>(gaugeField[site]);
+    for (int r = 0; r < N; ++r) {
+        prefetch_lines<0>(spinorFields[r][site]);
+    }
+    if (stream) {
+        return;
+    }
+    for (int mu = 0; mu < 4; ++mu) {
+        prefetch_lines<1>(*sTab->scatterOffset(DECOMP_SCATTER, cb, idx, c, mu));
+        prefetch_lines<1>(*sTab->scatterOffset(DECOMP_HVV_SCATTER, cb, idx, c, mu));
     }
 }
 
-// adj(gaugeMat) * spinProjectDirMinus
-void decomp_hvv_plus(int lo, int hi, int id,
-                     Spinor* spinorField, HalfSpinor* chi,
-                     GaugeMat (*gaugeField)[4], int cb,
-                     ShiftTable* sTab)
+// what the recons sweeps touch at target site i: the result unless it is
+// streamed, the half spinors of the gathers in types and the links if
+// withGauge
+template <typename T, int N>
+inline void prefetch_recons(int cb, int i, SpinorT<T>* const* spinorFields,
+                            PackedGaugeT<T> (*gaugeField)[4], ShiftTable<T, N>* sTab,
+                            bool withGauge, bool mvvGather, bool gather, bool stream)
 {
-    GaugeMat* um1;
-    GaugeMat* um2;
-    GaugeMat* um3;
-    GaugeMat* um4;
+    int idx = sTab->targetSite(cb, i);
+    int site = sTab->siteTable(idx);
+    if (withGauge) {
+        prefetch_lines<0>(gaugeField[site]);
+    }
+    if (!stream) {
+        for (int r = 0; r < N; ++r) {
+            prefetch_lines<1>(spinorFields[r][site]);
+        }
+    }
+    for (int mu = 0; mu < 4; ++mu) {
+        if (mvvGather) {
+            prefetch_lines<0>(*sTab->gatherOffset(RECONS_MVV_GATHER, cb, i, idx, mu));
+        }
+        if (gather) {
+            prefetch_lines<0>(*sTab->gatherOffset(RECONS_GATHER, cb, i, idx, mu));
+        }
+    }
+}
+} // namespace
+
+// spinProjectDirMinus to chi1 and adj(gaugeMat) * spinProjectDirPlus to chi2
+// in one sweep over the source
+template <typename T, int N>
+void decomp_fused_plus(int lo, int hi, int id,
+                       SpinorT<T>* const* spinorFields, HalfSpinorBlockT<T, N>* chi,
+                       PackedGaugeT<T> (*gaugeField)[4], int cb,
+                       ShiftTable<T, N>* sTab,
+                       SweepEpilogueT<T> const* ep)
+{
+    GaugeMatT<T> scratch[4];
+
+    HalfSpinorBlockT<T, N>* s3;
+    HalfSpinorBlockT<T, N>* s4;
+    HalfSpinorBlockT<T, N>* s5;
+    HalfSpinorBlockT<T, N>* s6;
 
-    HalfSpinor* s3;
-    HalfSpinor* s4;
-    HalfSpinor* s5;
-    HalfSpinor* s6;
+    HalfSpinorBlockT<T, N>* h3;
+    HalfSpinorBlockT<T, N>* h4;
+    HalfSpinorBlockT<T, N>* h5;
+    HalfSpinorBlockT<T, N>* h6;
+
+    FifthDimT<T> const* fifth = ep->fifth != 0 && !ep->fifth->dagger ? ep->fifth : 0;
+    SpinorT<T> mixed[N];
+
+    bool stream = (ep->streaming & STREAM_HALF_SPINORS) != 0;
+    HalfSpinorBlockT<T, N> staged[8];
 
     int subgridVolCB = sTab->subgridVolCB();
 
     int low = cb * subgridVolCB + lo;
     int high = cb * subgridVolCB + hi;
 
+    // the coordinates of the site and of the one prefetched, the on node
+    // neighbours are computed from them
+    int coords[4];
+    int ahead[4];
+    sTab->siteCoords(cb, low, coords);
+    if (prefetchDistance > 0 && low + prefetchDistance < high) {
+        sTab->siteCoords(cb, low + prefetchDistance, ahead);
+    }
+
     for (int idx = low; idx < high; ++idx) {
+        if (prefetchDistance > 0 && idx + prefetchDistance < high) {
+            prefetch_decomp(cb, idx + prefetchDistance, ahead, spinorFields, gaugeField, sTab, stream);
+            sTab->nextSiteCoords(cb, ahead);
+        }
         int curSite = sTab->siteTable(idx);
-        Spinor* sp = &spinorField[curSite];
-                
-        um1 = &gaugeField[curSite][0];
-        um2 = &gaugeField[curSite][1];
-        um3 = &gaugeField[curSite][2];
-        um4 = &gaugeField[curSite][3];
-        
-        s3 = sTab->halfspinorBufferOffset(DECOMP_HVV_SCATTER, idx, 0);
-        s4 = sTab->halfspinorBufferOffset(DECOMP_HVV_SCATTER, idx, 1);       
-        s5 = sTab->halfspinorBufferOffset(DECOMP_HVV_SCATTER, idx, 2);
-        s6 = sTab->halfspinorBufferOffset(DECOMP_HVV_SCATTER, idx, 3);
-        
-        decomp_hvv_gamma0_plus(*sp, *um1, *s3);
-        decomp_hvv_gamma1_plus(*sp, *um2, *s4);
-        decomp_hvv_gamma2_plus(*sp, *um3, *s5);
-        decomp_hvv_gamma3_plus(*sp, *um4, *s6);
+
+        // the links are loaded (or rebuilt) once for all the sources
+        GaugeMatT<T> const& um1 = linkMatrix(gaugeField[curSite][0], scratch[0]);
+        GaugeMatT<T> const& um2 = linkMatrix(gaugeField[curSite][1], scratch[1]);
+        GaugeMatT<T> const& um3 = linkMatrix(gaugeField[curSite][2], scratch[2]);
+        GaugeMatT<T> const& um4 = linkMatrix(gaugeField[curSite][3], scratch[3]);
+
+        s3 = sTab->scatterOffset(DECOMP_SCATTER, cb, idx, coords, 0);
+        s4 = sTab->scatterOffset(DECOMP_SCATTER, cb, idx, coords, 1);
+        s5 = sTab->scatterOffset(DECOMP_SCATTER, cb, idx, coords, 2);
+        s6 = sTab->scatterOffset(DECOMP_SCATTER, cb, idx, coords, 3);
+
+        h3 = sTab->scatterOffset(DECOMP_HVV_SCATTER, cb, idx, coords, 0);
+        h4 = sTab->scatterOffset(DECOMP_HVV_SCATTER, cb, idx, coords, 1);
+        h5 = sTab->scatterOffset(DECOMP_HVV_SCATTER, cb, idx, coords, 2);
+        h6 = sTab->scatterOffset(DECOMP_HVV_SCATTER, cb, idx, coords, 3);
+
+        // streamed, the site is staged and stored without allocating lines
+        HalfSpinorBlockT<T, N>* out[8] = {s3, s4, s5, s6, h3, h4, h5, h6};
+        if (stream) {
+            s3 = staged; s4 = staged + 1; s5 = staged + 2; s6 = staged + 3;
+            h3 = staged + 4; h4 = staged + 5; h5 = staged + 6; h6 = staged + 7;
+        }
+
+        // 5D: the hop acts on the mixed slices
+        if (fifth != 0) {
+            fifth_mix<T, N>(mixed, spinorFields, curSite, fifth->hop, *fifth);
+        }
+
+        for (int r = 0; r < N; ++r) {
+            SpinorT<T>& src = fifth != 0 ? mixed[r] : spinorFields[r][curSite];
+            decomp_hvv_4dir_plus(src, um1, um2, um3, um4,
+                                 (*s3)[r], (*s4)[r], (*s5)[r], (*s6)[r],
+                                 (*h3)[r], (*h4)[r], (*h5)[r], (*h6)[r]);
+        }
+        if (stream) {
+            for (int k = 0; k < 8; ++k) {
+                stream_store(*out[k], staged[k]);
+            }
+        }
+        sTab->nextSiteCoords(cb, coords);
+    }
+    if (stream) {
+        stream_fence();
     }
 }
 
+// sweeps target sites [lo, hi) as ordered by ShiftTable::targetSite
+template <typename T, int N>
 void mvv_recons_plus(int lo, int hi, int id,
-                     Spinor* spinorField, HalfSpinor* chi,
-                     GaugeMat (*gaugeField)[4], int cb,
-                     ShiftTable* sTab)
+                     SpinorT<T>* const* spinorFields, HalfSpinorBlockT<T, N>* chi,
+                     PackedGaugeT<T> (*gaugeField)[4], int cb,
+                     ShiftTable<T, N>* sTab,
+                     SweepEpilogueT<T> const* ep)
 {
-    GaugeMat* u1;
-    GaugeMat* u2;
-    GaugeMat* u3;
-    GaugeMat* u4;
-
-    HalfSpinor* hs1;
-    HalfSpinor* hs2;
-    HalfSpinor* hs3;
-    HalfSpinor* hs4;
-
-    int subgridVolCB = sTab->subgridVolCB();
-
-    int low = cb * subgridVolCB + lo;
-    int high = cb * subgridVolCB + hi;
-
-    for (int idx = low; idx < high; ++idx) {
+    GaugeMatT<T> scratch[4];
+
+    HalfSpinorBlockT<T, N>* hs1;
+    HalfSpinorBlockT<T, N>* hs2;
+    HalfSpinorBlockT<T, N>* hs3;
+    HalfSpinorBlockT<T, N>* hs4;
+
+    for (int i = lo; i < hi; ++i) {
+        if (prefetchDistance > 0 && i + prefetchDistance < hi) {
+            prefetch_recons(cb, i + prefetchDistance, spinorFields, gaugeField, sTab,
+                            true, true, false, false);
+        }
+        int idx = sTab->targetSite(cb, i);
         int curSite = sTab->siteTable(idx);
-        u1 = &gaugeField[curSite][0];
-        u2 = &gaugeField[curSite][1];
-        u3 = &gaugeField[curSite][2];
-        u4 = &gaugeField[curSite][3];
+        GaugeMatT<T> const& u1 = linkMatrix(gaugeField[curSite][0], scratch[0]);
+        GaugeMatT<T> const& u2 = linkMatrix(gaugeField[curSite][1], scratch[1]);
+        GaugeMatT<T> const& u3 = linkMatrix(gaugeField[curSite][2], scratch[2]);
+        GaugeMatT<T> const& u4 = linkMatrix(gaugeField[curSite][3], scratch[3]);
 
         hs1 = sTab->halfspinorBufferOffset(RECONS_MVV_GATHER, idx, 0);
         hs2 = sTab->halfspinorBufferOffset(RECONS_MVV_GATHER, idx, 1);
         hs3 = sTab->halfspinorBufferOffset(RECONS_MVV_GATHER, idx, 2);
         hs4 = sTab->halfspinorBufferOffset(RECONS_MVV_GATHER, idx, 3);
 
-        Spinor* sp = &spinorField[curSite];
-        mvv_recons_4dir_minus(*hs1, *hs2, *hs3, *hs4,
-                              *u1, *u2, *u3, *u4, *sp);
+        for (int r = 0; r < N; ++r) {
+            mvv_recons_4dir_minus((*hs1)[r], (*hs2)[r], (*hs3)[r], (*hs4)[r],
+                                  u1, u2, u3, u4, spinorFields[r][curSite]);
+        }
     }
 }
 
+template <typename T, int N>
 void recons_plus(int lo, int hi, int id,
-                 Spinor* spinorField, HalfSpinor* chi,
-                 GaugeMat (*gaugeField)[4], int cb,
-                 ShiftTable* sTab)
+                 SpinorT<T>* const* spinorFields, HalfSpinorBlockT<T, N>* chi,
+                 PackedGaugeT<T> (*gaugeField)[4], int cb,
+                 ShiftTable<T, N>* sTab,
+                 SweepEpilogueT<T> const* ep)
 {
-    HalfSpinor* hs1;
-    HalfSpinor* hs2;
-    HalfSpinor* hs3;
-    HalfSpinor* hs4;
-    Spinor* sp;
-
-    int subgridVolCB = sTab->subgridVolCB();
-
-    int low = cb * subgridVolCB + lo;
-    int high = cb * subgridVolCB + hi;
-
-    for (int idx = low; idx < high; ++idx) {
+    HalfSpinorBlockT<T, N>* hs1;
+    HalfSpinorBlockT<T, N>* hs2;
+    HalfSpinorBlockT<T, N>* hs3;
+    HalfSpinorBlockT<T, N>* hs4;
+
+    double* sums = ep->sums == 0 ? 0 : ep->sums + id*sweepSumStride<N>();
+    SpinorT<T>* res[N];
+
+    for (int i = lo; i < hi; ++i) {
+        if (prefetchDistance > 0 && i + prefetchDistance < hi) {
+            prefetch_recons(cb, i + prefetchDistance, spinorFields, gaugeField, sTab,
+                            false, false, true, false);
+        }
+        int idx = sTab->targetSite(cb, i);
         int curSite = sTab->siteTable(idx);
         hs1 = sTab->halfspinorBufferOffset(RECONS_GATHER, idx, 0);
         hs2 = sTab->halfspinorBufferOffset(RECONS_GATHER, idx, 1);
         hs3 = sTab->halfspinorBufferOffset(RECONS_GATHER, idx, 2);
         hs4 = sTab->halfspinorBufferOffset(RECONS_GATHER, idx, 3);
-        sp = &spinorField[curSite];
 
-        recons_4dir_plus(*hs1, *hs2, *hs3, *hs4, *sp);
+        for (int r = 0; r < N; ++r) {
+            recons_4dir_plus((*hs1)[r], (*hs2)[r], (*hs3)[r], (*hs4)[r],
+                             spinorFields[r][curSite]);
+            res[r] = &spinorFields[r][curSite];
+        }
+        sweep_epilogue<T, N>(*ep, curSite, res, sums);
     }
 }
 
-void decomp_minus(int lo, int hi, int id,
-                  Spinor* spinorField, HalfSpinor* chi,
-                  GaugeMat (*gaugeField)[4], int cb,
-                  ShiftTable* sTab)
+// mvv_recons and recons with a single store of the result.
+// only for sites whose halo data has arrived
+template <typename T, int N>
+void recons_fused_plus(int lo, int hi, int id,
+                       SpinorT<T>* const* spinorFields, HalfSpinorBlockT<T, N>* chi,
+                       PackedGaugeT<T> (*gaugeField)[4], int cb,
+                       ShiftTable<T, N>* sTab,
+                       SweepEpilogueT<T> const* ep)
 {
-    int subgridVolCB = sTab->subgridVolCB();
-    int low = subgridVolCB * cb + lo;
-    int high = subgridVolCB * cb + hi;
-    
-    HalfSpinor* s3;
-    HalfSpinor* s4;
-    HalfSpinor* s5;
-    HalfSpinor* s6;
-
-    Spinor* sp;
-
-    for (int idx = low; idx < high; ++idx) {
+    GaugeMatT<T> scratch[4];
+
+    HalfSpinorBlockT<T, N>* hs1;
+    HalfSpinorBlockT<T, N>* hs2;
+    HalfSpinorBlockT<T, N>* hs3;
+    HalfSpinorBlockT<T, N>* hs4;
+
+    HalfSpinorBlockT<T, N>* hs5;
+    HalfSpinorBlockT<T, N>* hs6;
+    HalfSpinorBlockT<T, N>* hs7;
+    HalfSpinorBlockT<T, N>* hs8;
+
+    double* sums = ep->sums == 0 ? 0 : ep->sums + id*sweepSumStride<N>();
+
+    // streamed, the results are staged and stored without allocating lines
+    bool stream = (ep->streaming & STREAM_RESULT) != 0;
+    SpinorT<T> staged[N];
+    SpinorT<T>* res[N];
+
+    for (int i = lo; i < hi; ++i) {
+        if (prefetchDistance > 0 && i + prefetchDistance < hi) {
+            prefetch_recons(cb, i + prefetchDistance, spinorFields, gaugeField, sTab,
+                            true, true, true, stream);
+        }
+        int idx = sTab->targetSite(cb, i);
         int curSite = sTab->siteTable(idx);
-        s3 = sTab->halfspinorBufferOffset(DECOMP_SCATTER, idx, 0);
-        s4 = sTab->halfspinorBufferOffset(DECOMP_SCATTER, idx, 1);
-        s5 = sTab->halfspinorBufferOffset(DECOMP_SCATTER, idx, 2);
-        s6 = sTab->halfspinorBufferOffset(DECOMP_SCATTER, idx, 3);
-        sp = &spinorField[curSite];
-
-        decomp_gamma0_plus(*sp, *s3);
-        decomp_gamma1_plus(*sp, *s4);
-        decomp_gamma2_plus(*sp, *s5);
-        decomp_gamma3_plus(*sp, *s6);
+        GaugeMatT<T> const& u1 = linkMatrix(gaugeField[curSite][0], scratch[0]);
+        GaugeMatT<T> const& u2 = linkMatrix(gaugeField[curSite][1], scratch[1]);
+        GaugeMatT<T> const& u3 = linkMatrix(gaugeField[curSite][2], scratch[2]);
+        GaugeMatT<T> const& u4 = linkMatrix(gaugeField[curSite][3], scratch[3]);
+
+        hs1 = sTab->gatherOffset(RECONS_MVV_GATHER, cb, i, idx, 0);
+        hs2 = sTab->gatherOffset(RECONS_MVV_GATHER, cb, i, idx, 1);
+        hs3 = sTab->gatherOffset(RECONS_MVV_GATHER, cb, i, idx, 2);
+        hs4 = sTab->gatherOffset(RECONS_MVV_GATHER, cb, i, idx, 3);
+
+        hs5 = sTab->gatherOffset(RECONS_GATHER, cb, i, idx, 0);
+        hs6 = sTab->gatherOffset(RECONS_GATHER, cb, i, idx, 1);
+        hs7 = sTab->gatherOffset(RECONS_GATHER, cb, i, idx, 2);
+        hs8 = sTab->gatherOffset(RECONS_GATHER, cb, i, idx, 3);
+
+        for (int r = 0; r < N; ++r) {
+            res[r] = stream ? &staged[r] : &spinorFields[r][curSite];
+            recons_fused_8dir_plus((*hs1)[r], (*hs2)[r], (*hs3)[r], (*hs4)[r],
+                                   u1, u2, u3, u4,
+                                   (*hs5)[r], (*hs6)[r], (*hs7)[r], (*hs8)[r],
+                                   *res[r]);
+        }
+        sweep_epilogue<T, N>(*ep, curSite, res, sums);
+        if (stream) {
+            for (int r = 0; r < N; ++r) {
+                stream_store(spinorFields[r][curSite], staged[r]);
+            }
+        }
+    }
+    if (stream) {
+        stream_fence();
     }
 }
 
-void decomp_hvv_minus(int lo, int hi, int id,
-                      Spinor* spinorField, HalfSpinor* chi,
-                      GaugeMat (*gaugeField)[4], int cb,
-                      ShiftTable* sTab)
+// spinProjectDirPlus to chi1 and adj(gaugeMat) * spinProjectDirMinus to chi2
+// in one sweep over the source
+template <typename T, int N>
+void decomp_fused_minus(int lo, int hi, int id,
+                        SpinorT<T>* const* spinorFields, HalfSpinorBlockT<T, N>* chi,
+                        PackedGaugeT<T> (*gaugeField)[4], int cb,
+                        ShiftTable<T, N>* sTab,
+                        SweepEpilogueT<T> const* ep)
 {
-    GaugeMat* um1;
-    GaugeMat* um2;
-    GaugeMat* um3;
-    GaugeMat* um4;
+    GaugeMatT<T> scratch[4];
+
+    HalfSpinorBlockT<T, N>* s3;
+    HalfSpinorBlockT<T, N>* s4;
+    HalfSpinorBlockT<T, N>* s5;
+    HalfSpinorBlockT<T, N>* s6;
+
+    HalfSpinorBlockT<T, N>* h3;
+    HalfSpinorBlockT<T, N>* h4;
+    HalfSpinorBlockT<T, N>* h5;
+    HalfSpinorBlockT<T, N>* h6;
 
-    HalfSpinor* s3;
-    HalfSpinor* s4;
-    HalfSpinor* s5;
-    HalfSpinor* s6;
+    FifthDimT<T> const* fifth = ep->fifth != 0 && !ep->fifth->dagger ? ep->fifth : 0;
+    SpinorT<T> mixed[N];
+
+    bool stream = (ep->streaming & STREAM_HALF_SPINORS) != 0;
+    HalfSpinorBlockT<T, N> staged[8];
 
     int subgridVolCB = sTab->subgridVolCB();
 
     int low = cb * subgridVolCB + lo;
     int high = cb * subgridVolCB + hi;
 
+    // the coordinates of the site and of the one prefetched, the on node
+    // neighbours are computed from them
+    int coords[4];
+    int ahead[4];
+    sTab->siteCoords(cb, low, coords);
+    if (prefetchDistance > 0 && low + prefetchDistance < high) {
+        sTab->siteCoords(cb, low + prefetchDistance, ahead);
+    }
+
     for (int idx = low; idx < high; ++idx) {
+        if (prefetchDistance > 0 && idx + prefetchDistance < high) {
+            prefetch_decomp(cb, idx + prefetchDistance, ahead, spinorFields, gaugeField, sTab, stream);
+            sTab->nextSiteCoords(cb, ahead);
+        }
         int curSite = sTab->siteTable(idx);
-        Spinor* sp = &spinorField[curSite];
-                
-        um1 = &gaugeField[curSite][0];
-        um2 = &gaugeField[curSite][1];
-        um3 = &gaugeField[curSite][2];
-        um4 = &gaugeField[curSite][3];
-        
-        s3 = sTab->halfspinorBufferOffset(DECOMP_HVV_SCATTER, idx, 0);
-        s4 = sTab->halfspinorBufferOffset(DECOMP_HVV_SCATTER, idx, 1);        
-        s5 = sTab->halfspinorBufferOffset(DECOMP_HVV_SCATTER, idx, 2);
-        s6 = sTab->halfspinorBufferOffset(DECOMP_HVV_SCATTER, idx, 3);
-        
-        decomp_hvv_gamma0_minus(*sp, *um1, *s3);
-        decomp_hvv_gamma1_minus(*sp, *um2, *s4);
-        decomp_hvv_gamma2_minus(*sp, *um3, *s5);
-        decomp_hvv_gamma3_minus(*sp, *um4, *s6);        
-    }    
+
+        // the links are loaded (or rebuilt) once for all the sources
+        GaugeMatT<T> const& um1 = linkMatrix(gaugeField[curSite][0], scratch[0]);
+        GaugeMatT<T> const& um2 = linkMatrix(gaugeField[curSite][1], scratch[1]);
+        GaugeMatT<T> const& um3 = linkMatrix(gaugeField[curSite][2], scratch[2]);
+        GaugeMatT<T> const& um4 = linkMatrix(gaugeField[curSite][3], scratch[3]);
+
+        s3 = sTab->scatterOffset(DECOMP_SCATTER, cb, idx, coords, 0);
+        s4 = sTab->scatterOffset(DECOMP_SCATTER, cb, idx, coords, 1);
+        s5 = sTab->scatterOffset(DECOMP_SCATTER, cb, idx, coords, 2);
+        s6 = sTab->scatterOffset(DECOMP_SCATTER, cb, idx, coords, 3);
+
+        h3 = sTab->scatterOffset(DECOMP_HVV_SCATTER, cb, idx, coords, 0);
+        h4 = sTab->scatterOffset(DECOMP_HVV_SCATTER, cb, idx, coords, 1);
+        h5 = sTab->scatterOffset(DECOMP_HVV_SCATTER, cb, idx, coords, 2);
+        h6 = sTab->scatterOffset(DECOMP_HVV_SCATTER, cb, idx, coords, 3);
+
+        // streamed, the site is staged and stored without allocating lines
+        HalfSpinorBlockT<T, N>* out[8] = {s3, s4, s5, s6, h3, h4, h5, h6};
+        if (stream) {
+            s3 = staged; s4 = staged + 1; s5 = staged + 2; s6 = staged + 3;
+            h3 = staged + 4; h4 = staged + 5; h5 = staged + 6; h6 = staged + 7;
+        }
+
+        // 5D: the hop acts on the mixed slices
+        if (fifth != 0) {
+            fifth_mix<T, N>(mixed, spinorFields, curSite, fifth->hop, *fifth);
+        }
+
+        for (int r = 0; r < N; ++r) {
+            SpinorT<T>& src = fifth != 0 ? mixed[r] : spinorFields[r][curSite];
+            decomp_hvv_4dir_minus(src, um1, um2, um3, um4,
+                                  (*s3)[r], (*s4)[r], (*s5)[r], (*s6)[r],
+                                  (*h3)[r], (*h4)[r], (*h5)[r], (*h6)[r]);
+        }
+        if (stream) {
+            for (int k = 0; k < 8; ++k) {
+                stream_store(*out[k], staged[k]);
+            }
+        }
+        sTab->nextSiteCoords(cb, coords);
+    }
+    if (stream) {
+        stream_fence();
+    }
 }
 
+// sweeps target sites [lo, hi) as ordered by ShiftTable::targetSite
+template <typename T, int N>
 void mvv_recons_minus(int lo, int hi, int id,
-                      Spinor* spinorField, HalfSpinor* chi,
-                      GaugeMat (*gaugeField)[4], int cb,
-                      ShiftTable* sTab)
+                      SpinorT<T>* const* spinorFields, HalfSpinorBlockT<T, N>* chi,
+                      PackedGaugeT<T> (*gaugeField)[4], int cb,
+                      ShiftTable<T, N>* sTab,
+                      SweepEpilogueT<T> const* ep)
 {
-    GaugeMat* u1;
-    GaugeMat* u2;
-    GaugeMat* u3;
-    GaugeMat* u4;
-
-    HalfSpinor* hs1;
-    HalfSpinor* hs2;
-    HalfSpinor* hs3;
-    HalfSpinor* hs4;
-
-    int subgridVolCB = sTab->subgridVolCB();
-
-    int low = cb * subgridVolCB + lo;
-    int high = cb * subgridVolCB + hi;
-
-    for (int idx = low; idx < high; ++idx) {
+    GaugeMatT<T> scratch[4];
+
+    HalfSpinorBlockT<T, N>* hs1;
+    HalfSpinorBlockT<T, N>* hs2;
+    HalfSpinorBlockT<T, N>* hs3;
+    HalfSpinorBlockT<T, N>* hs4;
+
+    for (int i = lo; i < hi; ++i) {
+        if (prefetchDistance > 0 && i + prefetchDistance < hi) {
+            prefetch_recons(cb, i + prefetchDistance, spinorFields, gaugeField, sTab,
+                            true, true, false, false);
+        }
+        int idx = sTab->targetSite(cb, i);
         int curSite = sTab->siteTable(idx);
-        u1 = &gaugeField[curSite][0];
-        u2 = &gaugeField[curSite][1];
-        u3 = &gaugeField[curSite][2];
-        u4 = &gaugeField[curSite][3];
+        GaugeMatT<T> const& u1 = linkMatrix(gaugeField[curSite][0], scratch[0]);
+        GaugeMatT<T> const& u2 = linkMatrix(gaugeField[curSite][1], scratch[1]);
+        GaugeMatT<T> const& u3 = linkMatrix(gaugeField[curSite][2], scratch[2]);
+        GaugeMatT<T> const& u4 = linkMatrix(gaugeField[curSite][3], scratch[3]);
 
         hs1 = sTab->halfspinorBufferOffset(RECONS_MVV_GATHER, idx, 0);
         hs2 = sTab->halfspinorBufferOffset(RECONS_MVV_GATHER, idx, 1);
         hs3 = sTab->halfspinorBufferOffset(RECONS_MVV_GATHER, idx, 2);
         hs4 = sTab->halfspinorBufferOffset(RECONS_MVV_GATHER, idx, 3);
 
-        Spinor* sp = &spinorField[curSite];
-        mvv_recons_4dir_plus(*hs1, *hs2, *hs3, *hs4,
-                              *u1, *u2, *u3, *u4, *sp);
+        for (int r = 0; r < N; ++r) {
+            mvv_recons_4dir_plus((*hs1)[r], (*hs2)[r], (*hs3)[r], (*hs4)[r],
+                                 u1, u2, u3, u4, spinorFields[r][curSite]);
+        }
     }
 }
 
+template <typename T, int N>
 void recons_minus(int lo, int hi, int id,
-                  Spinor* spinorField, HalfSpinor* chi,
-                  GaugeMat (*gaugeField)[4], int cb,
-                  ShiftTable* sTab)
+                  SpinorT<T>* const* spinorFields, HalfSpinorBlockT<T, N>* chi,
+                  PackedGaugeT<T> (*gaugeField)[4], int cb,
+                  ShiftTable<T, N>* sTab,
+                  SweepEpilogueT<T> const* ep)
 {
-    HalfSpinor* hs1;
-    HalfSpinor* hs2;
-    HalfSpinor* hs3;
-    HalfSpinor* hs4;
-    Spinor* sp;
-
-    int subgridVolCB = sTab->subgridVolCB();
-
-    int low = cb * subgridVolCB + lo;
-    int high = cb * subgridVolCB + hi;
-
-    for (int idx = low; idx < high; ++idx) {
+    HalfSpinorBlockT<T, N>* hs1;
+    HalfSpinorBlockT<T, N>* hs2;
+    HalfSpinorBlockT<T, N>* hs3;
+    HalfSpinorBlockT<T, N>* hs4;
+
+    double* sums = ep->sums == 0 ? 0 : ep->sums + id*sweepSumStride<N>();
+    SpinorT<T>* res[N];
+
+    for (int i = lo; i < hi; ++i) {
+        if (prefetchDistance > 0 && i + prefetchDistance < hi) {
+            prefetch_recons(cb, i + prefetchDistance, spinorFields, gaugeField, sTab,
+                            false, false, true, false);
+        }
+        int idx = sTab->targetSite(cb, i);
         int curSite = sTab->siteTable(idx);
         hs1 = sTab->halfspinorBufferOffset(RECONS_GATHER, idx, 0);
         hs2 = sTab->halfspinorBufferOffset(RECONS_GATHER, idx, 1);
         hs3 = sTab->halfspinorBufferOffset(RECONS_GATHER, idx, 2);
         hs4 = sTab->halfspinorBufferOffset(RECONS_GATHER, idx, 3);
-        sp = &spinorField[curSite];
 
-        recons_4dir_minus(*hs1, *hs2, *hs3, *hs4, *sp);
+        for (int r = 0; r < N; ++r) {
+            recons_4dir_minus((*hs1)[r], (*hs2)[r], (*hs3)[r], (*hs4)[r],
+                              spinorFields[r][curSite]);
+            res[r] = &spinorFields[r][curSite];
+        }
+        sweep_epilogue<T, N>(*ep, curSite, res, sums);
+    }
+}
+
+// mvv_recons and recons with a single store of the result.
+// only for sites whose halo data has arrived
+template <typename T, int N>
+void recons_fused_minus(int lo, int hi, int id,
+                        SpinorT<T>* const* spinorFields, HalfSpinorBlockT<T, N>* chi,
+                        PackedGaugeT<T> (*gaugeField)[4], int cb,
+                        ShiftTable<T, N>* sTab,
+                        SweepEpilogueT<T> const* ep)
+{
+    GaugeMatT<T> scratch[4];
+
+    HalfSpinorBlockT<T, N>* hs1;
+    HalfSpinorBlockT<T, N>* hs2;
+    HalfSpinorBlockT<T, N>* hs3;
+    HalfSpinorBlockT<T, N>* hs4;
+
+    HalfSpinorBlockT<T, N>* hs5;
+    HalfSpinorBlockT<T, N>* hs6;
+    HalfSpinorBlockT<T, N>* hs7;
+    HalfSpinorBlockT<T, N>* hs8;
+
+    double* sums = ep->sums == 0 ? 0 : ep->sums + id*sweepSumStride<N>();
+
+    // streamed, the results are staged and stored without allocating lines
+    bool stream = (ep->streaming & STREAM_RESULT) != 0;
+    SpinorT<T> staged[N];
+    SpinorT<T>* res[N];
+
+    for (int i = lo; i < hi; ++i) {
+        if (prefetchDistance > 0 && i + prefetchDistance < hi) {
+            prefetch_recons(cb, i + prefetchDistance, spinorFields, gaugeField, sTab,
+                            true, true, true, stream);
+        }
+        int idx = sTab->targetSite(cb, i);
+        int curSite = sTab->siteTable(idx);
+        GaugeMatT<T> const& u1 = linkMatrix(gaugeField[curSite][0], scratch[0]);
+        GaugeMatT<T> const& u2 = linkMatrix(gaugeField[curSite][1], scratch[1]);
+        GaugeMatT<T> const& u3 = linkMatrix(gaugeField[curSite][2], scratch[2]);
+        GaugeMatT<T> const& u4 = linkMatrix(gaugeField[curSite][3], scratch[3]);
+
+        hs1 = sTab->gatherOffset(RECONS_MVV_GATHER, cb, i, idx, 0);
+        hs2 = sTab->gatherOffset(RECONS_MVV_GATHER, cb, i, idx, 1);
+        hs3 = sTab->gatherOffset(RECONS_MVV_GATHER, cb, i, idx, 2);
+        hs4 = sTab->gatherOffset(RECONS_MVV_GATHER, cb, i, idx, 3);
+
+        hs5 = sTab->gatherOffset(RECONS_GATHER, cb, i, idx, 0);
+        hs6 = sTab->gatherOffset(RECONS_GATHER, cb, i, idx, 1);
+        hs7 = sTab->gatherOffset(RECONS_GATHER, cb, i, idx, 2);
+        hs8 = sTab->gatherOffset(RECONS_GATHER, cb, i, idx, 3);
+
+        for (int r = 0; r < N; ++r) {
+            res[r] = stream ? &staged[r] : &spinorFields[r][curSite];
+            recons_fused_8dir_minus((*hs1)[r], (*hs2)[r], (*hs3)[r], (*hs4)[r],
+                                    u1, u2, u3, u4,
+                                    (*hs5)[r], (*hs6)[r], (*hs7)[r], (*hs8)[r],
+                                    *res[r]);
+        }
+        sweep_epilogue<T, N>(*ep, curSite, res, sums);
+        if (stream) {
+            for (int r = 0; r < N; ++r) {
+                stream_store(spinorFields[r][curSite], staged[r]);
+            }
+        }
+    }
+    if (stream) {
+        stream_fence();
+    }
+}
+
+namespace
+{
+// what decomp_face touches at face site i: the source, the links and the
+// half spinors it scatters
+template <typename T, int N>
+inline void prefetch_face(int cb, int i, SpinorT<T>* const* spinorFields,
+                          PackedGaugeT<T> (*gaugeField)[4], ShiftTable<T, N>* sTab)
+{
+    int idx = sTab->faceSite(cb, i);
+    int site = sTab->siteTable(idx);
+    prefetch_lines<0>(gaugeField[site]);
+    for (int r = 0; r < N; ++r) {
+        prefetch_lines<0>(spinorFields[r][site]);
+    }
+    for (int mu = 0; mu < 4; ++mu) {
+        prefetch_lines<1>(*sTab->halfspinorBufferOffset(DECOMP_SCATTER, idx, mu));
+        prefetch_lines<1>(*sTab->halfspinorBufferOffset(DECOMP_HVV_SCATTER, idx, mu));
+    }
+}
+
+// what gather touches at target site i: the 8 links, the sources of the on
+// node neighbours, the halo half spinors of the others and the result
+// unless it is streamed
+template <typename T, int N>
+inline void prefetch_gather(int cb, int i, SpinorT<T>* const* spinorFields,
+                            SpinorT<T>* const* sourceFields,
+                            PackedGaugeT<T> (*gaugeField)[8], ShiftTable<T, N>* sTab,
+                            bool stream)
+{
+    int idx = sTab->targetSite(cb, i);
+    int site = sTab->siteTable(idx);
+    prefetch_lines<0>(gaugeField[site]);
+    for (int k = 0; k < 8; ++k) {
+        int nb = sTab->neighbour(idx, k);
+        if (nb >= 0) {
+            int nbSite = sTab->siteTable(nb);
+            for (int r = 0; r < N; ++r) {
+                prefetch_lines<0>(sourceFields[r][nbSite]);
+            }
+        } else {
+            prefetch_lines<0>(*sTab->halfspinorBufferOffset(k < 4 ? RECONS_MVV_GATHER : RECONS_GATHER,
+                                                            idx, k % 4));
+        }
+    }
+    if (!stream) {
+        for (int r = 0; r < N; ++r) {
+            prefetch_lines<1>(spinorFields[r][site]);
+        }
     }
 }
 
+template <typename T, int N, bool Plus>
+void decomp_face(int lo, int hi, SpinorT<T>* const* spinorFields,
+                 PackedGaugeT<T> (*gaugeField)[4], int cb, ShiftTable<T, N>* sTab)
+{
+    GaugeMatT<T> scratch[4];
+
+    for (int i = lo; i < hi; ++i) {
+        if (prefetchDistance > 0 && i + prefetchDistance < hi) {
+            prefetch_face(cb, i + prefetchDistance, spinorFields, gaugeField, sTab);
+        }
+        int idx = sTab->faceSite(cb, i);
+        int curSite = sTab->siteTable(idx);
+
+        GaugeMatT<T> const& um1 = linkMatrix(gaugeField[curSite][0], scratch[0]);
+        GaugeMatT<T> const& um2 = linkMatrix(gaugeField[curSite][1], scratch[1]);
+        GaugeMatT<T> const& um3 = linkMatrix(gaugeField[curSite][2], scratch[2]);
+        GaugeMatT<T> const& um4 = linkMatrix(gaugeField[curSite][3], scratch[3]);
+
+        HalfSpinorBlockT<T, N>* s[4];
+        HalfSpinorBlockT<T, N>* h[4];
+        for (int mu = 0; mu < 4; ++mu) {
+            s[mu] = sTab->halfspinorBufferOffset(DECOMP_SCATTER, idx, mu);
+            h[mu] = sTab->halfspinorBufferOffset(DECOMP_HVV_SCATTER, idx, mu);
+        }
+
+        // the on node entries land in chi1 / chi2, which nobody reads
+        for (int r = 0; r < N; ++r) {
+            if (Plus) {
+                decomp_hvv_4dir_plus(spinorFields[r][curSite], um1, um2, um3, um4,
+                                     (*s[0])[r], (*s[1])[r], (*s[2])[r], (*s[3])[r],
+                                     (*h[0])[r], (*h[1])[r], (*h[2])[r], (*h[3])[r]);
+            } else {
+                decomp_hvv_4dir_minus(spinorFields[r][curSite], um1, um2, um3, um4,
+                                      (*s[0])[r], (*s[1])[r], (*s[2])[r], (*s[3])[r],
+                                      (*h[0])[r], (*h[1])[r], (*h[2])[r], (*h[3])[r]);
+            }
+        }
+    }
+}
+
+template <typename T, int N, bool Plus>
+void gather(int lo, int hi, int id, SpinorT<T>* const* spinorFields,
+            SpinorT<T>* const* sourceFields, PackedGaugeT<T> (*gaugeField)[8], int cb,
+            ShiftTable<T, N>* sTab, SweepEpilogueT<T> const* ep)
+{
+    GaugeMatT<T> scratch[8];
+    GaugeMatT<T> const* u[8];
+
+    HalfSpinorT<T> local[8];
+    HalfSpinorT<T>* hs[8];
+
+    double* sums = ep->sums == 0 ? 0 : ep->sums + id*sweepSumStride<N>();
+
+    bool stream = (ep->streaming & STREAM_RESULT) != 0;
+    SpinorT<T> staged[N];
+    SpinorT<T>* res[N];
+
+    for (int i = lo; i < hi; ++i) {
+        if (prefetchDistance > 0 && i + prefetchDistance < hi) {
+            prefetch_gather(cb, i + prefetchDistance, spinorFields, sourceFields, gaugeField,
+                            sTab, stream);
+        }
+        int idx = sTab->targetSite(cb, i);
+        int curSite = sTab->siteTable(idx);
+
+        // the sources of the on node neighbours, -1 for the halos
+        int nbSite[8];
+        for (int k = 0; k < 8; ++k) {
+            int nb = sTab->neighbour(idx, k);
+            nbSite[k] = nb < 0 ? -1 : sTab->siteTable(nb);
+        }
+        for (int mu = 0; mu < 4; ++mu) {
+            u[mu] = &linkMatrix(gaugeField[curSite][mu], scratch[mu]);
+            if (nbSite[4 + mu] >= 0) {
+                u[4 + mu] = &linkMatrix(gaugeField[curSite][4 + mu], scratch[4 + mu]);
+            }
+        }
+
+        for (int r = 0; r < N; ++r) {
+            for (int mu = 0; mu < 4; ++mu) {
+                if (nbSite[mu] >= 0) {
+                    decomp_1dir<T, Plus, false>(sourceFields[r][nbSite[mu]], mu, 0, local[mu]);
+                    hs[mu] = &local[mu];
+                } else {
+                    hs[mu] = &(*sTab->halfspinorBufferOffset(RECONS_MVV_GATHER, idx, mu))[r];
+                }
+                if (nbSite[4 + mu] >= 0) {
+                    decomp_1dir<T, Plus, true>(sourceFields[r][nbSite[4 + mu]], mu, *u[4 + mu], local[4 + mu]);
+                    hs[4 + mu] = &local[4 + mu];
+                } else {
+                    hs[4 + mu] = &(*sTab->halfspinorBufferOffset(RECONS_GATHER, idx, mu))[r];
+                }
+            }
+
+            res[r] = stream ? &staged[r] : &spinorFields[r][curSite];
+            if (Plus) {
+                recons_fused_8dir_plus(*hs[0], *hs[1], *hs[2], *hs[3],
+                                       *u[0], *u[1], *u[2], *u[3],
+                                       *hs[4], *hs[5], *hs[6], *hs[7],
+                                       *res[r]);
+            } else {
+                recons_fused_8dir_minus(*hs[0], *hs[1], *hs[2], *hs[3],
+                                        *u[0], *u[1], *u[2], *u[3],
+                                        *hs[4], *hs[5], *hs[6], *hs[7],
+                                        *res[r]);
+            }
+        }
+        sweep_epilogue<T, N>(*ep, curSite, res, sums);
+        if (stream) {
+            for (int r = 0; r < N; ++r) {
+                stream_store(spinorFields[r][curSite], staged[r]);
+            }
+        }
+    }
+    if (stream) {
+        stream_fence();
+    }
+}
+} // namespace
+
+template <typename T, int N>
+void decomp_face_plus(int lo, int hi, int id,
+                      SpinorT<T>* const* spinorFields, HalfSpinorBlockT<T, N>* chi,
+                      PackedGaugeT<T> (*gaugeField)[4], int cb,
+                      ShiftTable<T, N>* sTab,
+                      SweepEpilogueT<T> const* ep)
+{
+    decomp_face<T, N, true>(lo, hi, spinorFields, gaugeField, cb, sTab);
+}
+
+template <typename T, int N>
+void decomp_face_minus(int lo, int hi, int id,
+                       SpinorT<T>* const* spinorFields, HalfSpinorBlockT<T, N>* chi,
+                       PackedGaugeT<T> (*gaugeField)[4], int cb,
+                       ShiftTable<T, N>* sTab,
+                       SweepEpilogueT<T> const* ep)
+{
+    decomp_face<T, N, false>(lo, hi, spinorFields, gaugeField, cb, sTab);
+}
+
+template <typename T, int N>
+void gather_plus(int lo, int hi, int id,
+                 SpinorT<T>* const* spinorFields, SpinorT<T>* const* sourceFields,
+                 PackedGaugeT<T> (*gaugeField)[8], int cb,
+                 ShiftTable<T, N>* sTab,
+                 SweepEpilogueT<T> const* ep)
+{
+    gather<T, N, true>(lo, hi, id, spinorFields, sourceFields, gaugeField, cb, sTab, ep);
+}
+
+template <typename T, int N>
+void gather_minus(int lo, int hi, int id,
+                  SpinorT<T>* const* spinorFields, SpinorT<T>* const* sourceFields,
+                  PackedGaugeT<T> (*gaugeField)[8], int cb,
+                  ShiftTable<T, N>* sTab,
+                  SweepEpilogueT<T> const* ep)
+{
+    gather<T, N, false>(lo, hi, id, spinorFields, sourceFields, gaugeField, cb, sTab, ep);
+}
+
+#define INSTANTIATE_SWEEP(name, T, N)                                             \
+    template void name<T, N>(int lo, int hi, int id,                              \
+                             SpinorT<T>* const* spinorFields,                     \
+                             HalfSpinorBlockT<T, N>* chi,                         \
+                             PackedGaugeT<T> (*gaugeField)[4], int cb,            \
+                             ShiftTable<T, N>* sTab,                              \
+                             SweepEpilogueT<T> const* ep);
+
+#define INSTANTIATE_GATHER(name, T, N)                                            \
+    template void name<T, N>(int lo, int hi, int id,                              \
+                             SpinorT<T>* const* spinorFields,                     \
+                             SpinorT<T>* const* sourceFields,                     \
+                             PackedGaugeT<T> (*gaugeField)[8], int cb,            \
+                             ShiftTable<T, N>* sTab,                              \
+                             SweepEpilogueT<T> const* ep);
+
+#define INSTANTIATE_SWEEPS(T, N)                 \
+    INSTANTIATE_SWEEP(decomp_fused_plus, T, N)   \
+    INSTANTIATE_SWEEP(mvv_recons_plus, T, N)     \
+    INSTANTIATE_SWEEP(recons_plus, T, N)         \
+    INSTANTIATE_SWEEP(recons_fused_plus, T, N)   \
+    INSTANTIATE_SWEEP(decomp_fused_minus, T, N)  \
+    INSTANTIATE_SWEEP(mvv_recons_minus, T, N)    \
+    INSTANTIATE_SWEEP(recons_minus, T, N)        \
+    INSTANTIATE_SWEEP(recons_fused_minus, T, N)  \
+    INSTANTIATE_SWEEP(decomp_face_plus, T, N)    \
+    INSTANTIATE_SWEEP(decomp_face_minus, T, N)   \
+    INSTANTIATE_GATHER(gather_plus, T, N)        \
+    INSTANTIATE_GATHER(gather_minus, T, N)
+
+INSTANTIATE_SWEEPS(float, 1)
+INSTANTIATE_SWEEPS(float, 2)
+INSTANTIATE_SWEEPS(float, 4)
+INSTANTIATE_SWEEPS(float, 8)
+INSTANTIATE_SWEEPS(float, 12)
+INSTANTIATE_SWEEPS(float, 16)
+INSTANTIATE_SWEEPS(float, 20)
+INSTANTIATE_SWEEPS(float, 24)
+INSTANTIATE_SWEEPS(double, 1)
+INSTANTIATE_SWEEPS(double, 2)
+INSTANTIATE_SWEEPS(double, 4)
+INSTANTIATE_SWEEPS(double, 8)
+INSTANTIATE_SWEEPS(double, 12)
+INSTANTIATE_SWEEPS(double, 16)
+INSTANTIATE_SWEEPS(double, 20)
+INSTANTIATE_SWEEPS(double, 24)
+
 } // namespace Chroma
-    
@@ -0,0 +1,477 @@
+#include <omp.h>
+
+#include "neon_dslash_soa.h"
+#include "neon_dslash_soa_details.h"
+#include "neon_dslash_gauge.h"
+
+namespace Chroma
+{
+
+namespace
+{
+// Func should be stateless
+// Threads split the range [0, nsites), func(low, high)
+template <typename Func>
+void dispatchSites(Func func, int const nsites)
+{
+    int nthreads;
+    int id;
+    int low;
+    int high;
+
+#pragma omp parallel shared(func, nsites) private(id, nthreads, low, high) default(none)
+    {
+        nthreads = omp_get_num_threads();
+        id = omp_get_thread_num();
+        low = nsites * id / nthreads;
+        high = nsites * (id+1) / nthreads;
+        func(low, high);
+    }
+}
+
+// the comms buffers of one direction, null if the direction is local.
+// along t an entry is the one lane the receiver uses
+template <typename T>
+struct SoAHalo
+{
+    HalfSpinorSoAT<T>* fromForward;
+    HalfSpinorSoAT<T>* fromBack;
+    HalfSpinorLaneT<T>* laneFromForward;
+    HalfSpinorLaneT<T>* laneFromBack;
+};
+
+// U(x) (1 - isign gamma_mu) psi(x + mu)
+template <typename T, int Mu, int S>
+inline void soa_forward(SpinorVec<T>& acc, SoANeighbour const& nb,
+                        SpinorSoAT<T> const* psi, GaugeMatSoAT<T> const& u,
+                        SoAHalo<T> const& halo)
+{
+    HalfSpinorVec<T> h;
+    HalfSpinorVec<T> uh;
+
+    if (nb.kind == SOA_HALO) {
+        soa_load_half(halo.fromForward[nb.face], h);
+    } else {
+        soa_project<Mu, -S>(psi[nb.site], h);
+        if (nb.kind == SOA_LANE_SHIFT) {
+            soa_shift_fwd<T>(h, nb.face >= 0 ? halo.laneFromForward[nb.face] : 0);
+        }
+    }
+
+    soa_mult_u<T>(u, h, uh);
+    soa_accumulate<Mu, -S>(acc, uh);
+}
+
+// adj(U(x - mu)) (1 + isign gamma_mu) psi(x - mu)
+template <typename T, int Mu, int S>
+inline void soa_backward(SpinorVec<T>& acc, SoANeighbour const& nb,
+                         SpinorSoAT<T> const* psi, GaugeMatSoAT<T> const (*gauge)[4],
+                         SoAHalo<T> const& halo)
+{
+    HalfSpinorVec<T> uh;
+
+    if (nb.kind == SOA_HALO) {
+        soa_load_half(halo.fromBack[nb.face], uh);
+    } else {
+        HalfSpinorVec<T> h;
+        soa_project<Mu, S>(psi[nb.site], h);
+        soa_mult_adj_u<T>(gauge[nb.site][Mu], h, uh);
+        if (nb.kind == SOA_LANE_SHIFT) {
+            soa_shift_back<T>(uh, nb.face >= 0 ? halo.laneFromBack[nb.face] : 0);
+        }
+    }
+
+    soa_accumulate<Mu, S>(acc, uh);
+}
+
+template <typename T, int Mu, int S>
+inline void soa_dir(SpinorVec<T>& acc, SoANeighbour const* nb, int site,
+                    SpinorSoAT<T> const* psi, GaugeMatSoAT<T> const (*gauge)[4],
+                    SoAHalo<T> const* halo)
+{
+    soa_forward<T, Mu, S>(acc, nb[2*Mu], psi, gauge[site][Mu], halo[Mu]);
+    soa_backward<T, Mu, S>(acc, nb[2*Mu + 1], psi, gauge, halo[Mu]);
+}
+
+// the target vector sites sites[lo, hi)
+template <typename T, int S>
+void soa_dslash(int lo, int hi, int const* sites, SoANeighbour const* neighbours,
+                SpinorSoAT<T>* res, SpinorSoAT<T> const* psi,
+                GaugeMatSoAT<T> const (*gauge)[4], SoAHalo<T> const* halo)
+{
+    SpinorVec<T> acc;
+
+    for (int i = lo; i < hi; ++i) {
+        int site = sites[i];
+        SoANeighbour const* nb = neighbours + 8*site;
+
+        soa_zero<T>(acc);
+        soa_dir<T, 0, S>(acc, nb, site, psi, gauge, halo);
+        soa_dir<T, 1, S>(acc, nb, site, psi, gauge, halo);
+        soa_dir<T, 2, S>(acc, nb, site, psi, gauge, halo);
+        soa_dir<T, 3, S>(acc, nb, site, psi, gauge, halo);
+        soa_store_spinor<T>(res[site], acc);
+    }
+}
+
+// the lower face goes backward as (1 - isign gamma_mu) psi, the upper face
+// forward as adj(U) (1 + isign gamma_mu) psi
+template <typename T, int Mu, int S>
+void soa_face(int lo, int hi, int const* lower, int const* upper,
+              SpinorSoAT<T> const* psi, GaugeMatSoAT<T> const (*gauge)[4],
+              HalfSpinorSoAT<T>* toBack, HalfSpinorSoAT<T>* toForward)
+{
+    HalfSpinorVec<T> h;
+    HalfSpinorVec<T> uh;
+
+    for (int f = lo; f < hi; ++f) {
+        soa_project<Mu, -S>(psi[lower[f]], h);
+        soa_store_half(toBack[f], h);
+
+        soa_project<Mu, S>(psi[upper[f]], h);
+        soa_mult_adj_u<T>(gauge[upper[f]][Mu], h, uh);
+        soa_store_half(toForward[f], uh);
+    }
+}
+
+// along t the faces are the vector sites of the first and last t slice.
+// the neighbour node continues only the first slab backward and the last
+// one forward, so only lane 0 and lane SoALanes - 1 are sent
+template <typename T, int S>
+void soa_face_t(int lo, int hi, int const* lower, int const* upper,
+                SpinorSoAT<T> const* psi, GaugeMatSoAT<T> const (*gauge)[4],
+                HalfSpinorLaneT<T>* toBack, HalfSpinorLaneT<T>* toForward)
+{
+    HalfSpinorVec<T> h;
+    HalfSpinorVec<T> uh;
+
+    for (int f = lo; f < hi; ++f) {
+        soa_project<3, -S>(psi[lower[f]], h);
+        soa_store_lane<0>(toBack[f], h);
+
+        soa_project<3, S>(psi[upper[f]], h);
+        soa_mult_adj_u<T>(gauge[upper[f]][3], h, uh);
+        soa_store_lane<SoALanes - 1>(toForward[f], uh);
+    }
+}
+
+// mu < 3
+template <typename T, int S>
+void soa_face_dir(int mu, int lo, int hi, int const* lower, int const* upper,
+                  SpinorSoAT<T> const* psi, GaugeMatSoAT<T> const (*gauge)[4],
+                  HalfSpinorSoAT<T>* toBack, HalfSpinorSoAT<T>* toForward)
+{
+    switch (mu) {
+    case 0:
+        soa_face<T, 0, S>(lo, hi, lower, upper, psi, gauge, toBack, toForward);
+        break;
+    case 1:
+        soa_face<T, 1, S>(lo, hi, lower, upper, psi, gauge, toBack, toForward);
+        break;
+    default:
+        soa_face<T, 2, S>(lo, hi, lower, upper, psi, gauge, toBack, toForward);
+        break;
+    }
+}
+} // namespace anonymous
+
+template <typename T>
+NeonDslashSoAT<T>::~NeonDslashSoAT()
+{
+    if (xgauge != 0) {
+        QMP_free_memory(xgauge);
+    }
+}
+
+template <typename T>
+void NeonDslashSoAT<T>::create(int subgrid[], /* int subgrid[4] */
+                               PackedGauge* packedGauge,
+                               int (*getLinearSiteIndex)(const int coord[]),
+                               HaloCompression haloCompression)
+{
+    for (int mu = 0; mu < 4; ++mu) {
+        if (subgrid[mu] % 2 != 0) {
+            QMP_error("NeonDslashSoA: subgrid extents must be even");
+            QMP_abort(1);
+        }
+    }
+    if (subgrid[3] % (2*SoALanes) != 0) {
+        QMP_error("NeonDslashSoA: subgrid[3] must be divisible by %d", 2*SoALanes);
+        QMP_abort(1);
+    }
+
+    for (int mu = 0; mu < 3; ++mu) {
+        vsubgrid[mu] = subgrid[mu];
+    }
+    vsubgrid[3] = subgrid[3] / SoALanes;
+    int vol = vsubgrid[0]*vsubgrid[1]*vsubgrid[2]*vsubgrid[3];
+    vol_cb = vol / 2;
+
+    // the comms run on vector sites: a buffer entry is the half spinor of
+    // SoALanes sites, along t only the lane the receiver uses
+    const int faceBlocks[4] = {SoALanes, SoALanes, SoALanes, 1};
+    dslashTable.reset(new DslashTable<T, SoALanes>(vsubgrid, haloCompression, faceBlocks));
+
+    const int* machine_size = QMP_get_logical_dimensions();
+    const int* node_coord = QMP_get_logical_coordinates();
+    int num = 0;
+    for (int mu = 0; mu < 4; ++mu) {
+        commIndex[mu] = machine_size[mu] > 1 ? num++ : -1;
+    }
+
+    // vector site of the (reduced) coordinate c
+    auto vectorSite = [this](const int c[]) {
+        int lex = c[0] + vsubgrid[0]*(c[1] + vsubgrid[1]*(c[2] + vsubgrid[2]*c[3]));
+        return ((c[0] + c[1] + c[2] + c[3]) & 1)*vol_cb + lex/2;
+    };
+
+    // buffer entry of c on the faces normal to mu
+    auto faceIndex = [this](const int c[], int mu) {
+        int lex = 0;
+        for (int nu = 3; nu >= 0; --nu) {
+            if (nu != mu) {
+                lex = lex*vsubgrid[nu] + c[nu];
+            }
+        }
+        return lex/2;
+    };
+
+    siteIndex.assign(vol*SoALanes, 0);
+    neighbours.assign(vol*8, SoANeighbour());
+    for (int cb = 0; cb < 2; ++cb) {
+        targetSites[cb][0].clear();
+        targetSites[cb][1].clear();
+        for (int mu = 0; mu < 4; ++mu) {
+            int nface = vol / vsubgrid[mu] / 2;
+            faceSites[cb][0][mu].assign(nface, 0);
+            faceSites[cb][1][mu].assign(nface, 0);
+        }
+    }
+
+    int c[4];
+    for (c[3] = 0; c[3] < vsubgrid[3]; ++c[3]) {
+        for (c[2] = 0; c[2] < vsubgrid[2]; ++c[2]) {
+            for (c[1] = 0; c[1] < vsubgrid[1]; ++c[1]) {
+                for (c[0] = 0; c[0] < vsubgrid[0]; ++c[0]) {
+                    int site = vectorSite(c);
+                    int cb = site / vol_cb;
+
+                    for (int k = 0; k < SoALanes; ++k) {
+                        int coord[4];
+                        for (int mu = 0; mu < 4; ++mu) {
+                            coord[mu] = c[mu] + subgrid[mu]*node_coord[mu];
+                        }
+                        coord[3] += k*vsubgrid[3];
+                        siteIndex[site*SoALanes + k] = getLinearSiteIndex(coord);
+                    }
+
+                    bool boundary = false;
+                    for (int mu = 0; mu < 4; ++mu) {
+                        bool lower = c[mu] == 0;
+                        bool upper = c[mu] == vsubgrid[mu] - 1;
+                        bool split = commIndex[mu] >= 0;
+
+                        if (lower) {
+                            faceSites[cb][0][mu][faceIndex(c, mu)] = site;
+                        }
+                        if (upper) {
+                            faceSites[cb][1][mu][faceIndex(c, mu)] = site;
+                        }
+
+                        int f[4] = {c[0], c[1], c[2], c[3]};
+                        int b[4] = {c[0], c[1], c[2], c[3]};
+                        f[mu] = upper ? 0 : c[mu] + 1;
+                        b[mu] = lower ? vsubgrid[mu] - 1 : c[mu] - 1;
+
+                        SoANeighbour& fwd = neighbours[8*site + 2*mu];
+                        SoANeighbour& back = neighbours[8*site + 2*mu + 1];
+                        fwd = SoANeighbour{SOA_LOCAL, vectorSite(f), -1};
+                        back = SoANeighbour{SOA_LOCAL, vectorSite(b), -1};
+
+                        // along t the slabs continue in the next lane
+                        if (mu == 3) {
+                            if (upper) {
+                                fwd.kind = SOA_LANE_SHIFT;
+                                fwd.face = split ? faceIndex(c, mu) : -1;
+                            }
+                            if (lower) {
+                                back.kind = SOA_LANE_SHIFT;
+                                back.face = split ? faceIndex(c, mu) : -1;
+                            }
+                        } else if (split) {
+                            if (upper) {
+                                fwd = SoANeighbour{SOA_HALO, -1, faceIndex(c, mu)};
+                            }
+                            if (lower) {
+                                back = SoANeighbour{SOA_HALO, -1, faceIndex(c, mu)};
+                            }
+                        }
+                        boundary = boundary || (split && (lower || upper));
+                    }
+                    targetSites[cb][boundary ? 1 : 0].push_back(site);
+                }
+            }
+        }
+    }
+
+    if (xgauge != 0) {
+        QMP_free_memory(xgauge);
+    }
+    if ((xgauge = QMP_allocate_aligned_memory(vol*sizeof(GaugeMatSoA[4]), Cache::CacheLineSize, 0)) == 0) {
+        QMP_error("NeonDslashSoA: could not allocate the gauge field");
+        QMP_abort(1);
+    }
+    gauge = (GaugeMatSoA(*)[4]) QMP_get_memory_pointer(xgauge);
+
+    importGauge(packedGauge);
+}
+
+template <typename T>
+void NeonDslashSoAT<T>::importGauge(const PackedGauge* packedGauge)
+{
+    int vol = 2*vol_cb;
+
+#pragma omp parallel for
+    for (int site = 0; site < vol; ++site) {
+        GaugeMatT<T> scratch;
+        for (int k = 0; k < SoALanes; ++k) {
+            const PackedGauge* links = packedGauge + 4*siteIndex[site*SoALanes + k];
+            for (int mu = 0; mu < 4; ++mu) {
+                GaugeMatT<T> const& u = linkMatrix(links[mu], scratch);
+                for (int n = 0; n < 3; ++n) {
+                    for (int m = 0; m < 3; ++m) {
+                        gauge[site][mu][n][m][0][k] = u[n][m][0];
+                        gauge[site][mu][n][m][1][k] = u[n][m][1];
+                    }
+                }
+            }
+        }
+    }
+}
+
+template <typename T>
+void NeonDslashSoAT<T>::importSpinor(T* soaArg, const T* psiArg, int cb) const
+{
+    SpinorSoA* soa = (SpinorSoA*) soaArg;
+    const Spinor* psi = (const Spinor*) psiArg;
+
+#pragma omp parallel for
+    for (int site = cb*vol_cb; site < (cb+1)*vol_cb; ++site) {
+        for (int k = 0; k < SoALanes; ++k) {
+            const Spinor& src = psi[siteIndex[site*SoALanes + k]];
+            for (int s = 0; s < 4; ++s) {
+                for (int c = 0; c < 3; ++c) {
+                    soa[site][s][c][0][k] = src[s][c][0];
+                    soa[site][s][c][1][k] = src[s][c][1];
+                }
+            }
+        }
+    }
+}
+
+template <typename T>
+void NeonDslashSoAT<T>::exportSpinor(T* psiArg, const T* soaArg, int cb) const
+{
+    const SpinorSoA* soa = (const SpinorSoA*) soaArg;
+    Spinor* psi = (Spinor*) psiArg;
+
+#pragma omp parallel for
+    for (int site = cb*vol_cb; site < (cb+1)*vol_cb; ++site) {
+        for (int k = 0; k < SoALanes; ++k) {
+            Spinor& dst = psi[siteIndex[site*SoALanes + k]];
+            for (int s = 0; s < 4; ++s) {
+                for (int c = 0; c < 3; ++c) {
+                    dst[s][c][0] = soa[site][s][c][0][k];
+                    dst[s][c][1] = soa[site][s][c][1][k];
+                }
+            }
+        }
+    }
+}
+
+template <typename T>
+void NeonDslashSoAT<T>::apply(T* chi, T* psi, int isign, int cb) const
+{
+    if (isign == 1) {
+        applySign<1>((SpinorSoA*) chi, (const SpinorSoA*) psi, cb);
+    } else if (isign == -1) {
+        applySign<-1>((SpinorSoA*) chi, (const SpinorSoA*) psi, cb);
+    } else {
+        // not possible
+        throw 0;
+    }
+}
+
+template <typename T>
+template <int isign>
+void NeonDslashSoAT<T>::applySign(SpinorSoA* res, const SpinorSoA* psi, int cb) const
+{
+    GaugeMatSoA const (*u)[4] = gauge;
+    HalfSpinorSoA* (*recv)[4] = (HalfSpinorSoA*(*)[4]) dslashTable->getRecvBufptr();
+    HalfSpinorSoA* (*send)[4] = (HalfSpinorSoA*(*)[4]) dslashTable->getSendBufptr();
+
+    SoAHalo<T> halo[4];
+    for (int mu = 0; mu < 4; ++mu) {
+        int m = commIndex[mu];
+        halo[mu].fromForward = m >= 0 ? recv[0][m] : 0;
+        halo[mu].fromBack = m >= 0 ? recv[1][m] : 0;
+        halo[mu].laneFromForward = (HalfSpinorLane*) halo[mu].fromForward;
+        halo[mu].laneFromBack = (HalfSpinorLane*) halo[mu].fromBack;
+    }
+
+    int sourceCB = 1 - cb;
+    int targetCB = cb;
+
+    dslashTable->startReceives();
+
+    for (int mu = 0; mu < 4; ++mu) {
+        int m = commIndex[mu];
+        if (m < 0) {
+            continue;
+        }
+        const int* lower = faceSites[sourceCB][0][mu].data();
+        const int* upper = faceSites[sourceCB][1][mu].data();
+        if (mu == 3) {
+            HalfSpinorLane* toBack = (HalfSpinorLane*) send[0][m];
+            HalfSpinorLane* toForward = (HalfSpinorLane*) send[1][m];
+            dispatchSites([=](int lo, int hi) {
+                              soa_face_t<T, isign>(lo, hi, lower, upper, psi, u, toBack, toForward);
+                          },
+                          faceSites[sourceCB][0][mu].size());
+            continue;
+        }
+        HalfSpinorSoA* toBack = send[0][m];
+        HalfSpinorSoA* toForward = send[1][m];
+        dispatchSites([=](int lo, int hi) {
+                          soa_face_dir<T, isign>(mu, lo, hi, lower, upper, psi, u, toBack, toForward);
+                      },
+                      faceSites[sourceCB][0][mu].size());
+    }
+
+    dslashTable->startSends();
+
+    // interior sites need no halo data: overlap them with the comms
+    const int* interior = targetSites[targetCB][0].data();
+    const int* boundary = targetSites[targetCB][1].data();
+    const SoANeighbour* nb = neighbours.data();
+
+    dispatchSites([=, &halo](int lo, int hi) {
+                      soa_dslash<T, isign>(lo, hi, interior, nb, res, psi, u, halo);
+                  },
+                  targetSites[targetCB][0].size());
+
+    dslashTable->finishReceiveFromBack();
+    dslashTable->finishReceiveFromForward();
+
+    dispatchSites([=, &halo](int lo, int hi) {
+                      soa_dslash<T, isign>(lo, hi, boundary, nb, res, psi, u, halo);
+                  },
+                  targetSites[targetCB][1].size());
+
+    dslashTable->finishSends();
+}
+
+template class NeonDslashSoAT<float>;
+template class NeonDslashSoAT<double>;
+
+} // namespace Chroma
@@ -1,11 +1,98 @@
 #include "shift_table.h"
 
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
 // 
 
 namespace Chroma
 {
 
-ShiftTable::ShiftTable(
+namespace
+{
+std::string& cacheDirectory()
+{
+    static std::string dir;
+    return dir;
+}
+
+/* The cache file: the header, then the site table, the offset table, the
+   target sites of both cb's, the neighbour table and the face sites of both
+   cb's, each aligned to a cache line. The offsets are relative to the
+   buffers (see OffsetBase), only the buffers in use are recorded */
+const char CacheMagic[8] = {'N', 'D', 'S', 'H', 'I', 'F', 'T', '1'};
+
+struct CacheHeader
+{
+    char magic[8];
+    int32_t subgrid[4];
+    int32_t machine[4];
+    int32_t node;
+    int32_t order;
+    int32_t neighbours;
+    uint32_t bases;               /* bit b: offset_bases[b] is set */
+    uint64_t order_hash;          /* of the site order, the tiles depend on T and N */
+    int32_t target_sites_begin[2][NUM_TARGET_SITE_CLASSES+1];
+    int32_t num_face_sites[2];
+};
+
+size_t cacheAlign(size_t bytes)
+{
+    return (bytes + Cache::CacheLineSize - 1)/Cache::CacheLineSize*Cache::CacheLineSize;
+}
+
+/* The start of each section and the total size */
+enum CacheSection {
+    CACHE_SITE_TABLE=0,
+    CACHE_OFFSET_TABLE,
+    CACHE_TARGET_SITES,
+    CACHE_NEIGHBOURS,
+    CACHE_FACE_SITES_0,
+    CACHE_FACE_SITES_1,
+    CACHE_END
+};
+
+void cacheSections(const CacheHeader& h, int subgrid_vol, size_t start[CACHE_END+1])
+{
+    size_t bytes[CACHE_END];
+    bytes[CACHE_SITE_TABLE] = subgrid_vol*sizeof(int);
+    bytes[CACHE_OFFSET_TABLE] = 4*4*subgrid_vol*sizeof(uint32_t);
+    bytes[CACHE_TARGET_SITES] = subgrid_vol*sizeof(int);
+    bytes[CACHE_NEIGHBOURS] = h.neighbours ? 8*subgrid_vol*sizeof(int) : 0;
+    bytes[CACHE_FACE_SITES_0] = h.num_face_sites[0]*sizeof(int);
+    bytes[CACHE_FACE_SITES_1] = h.num_face_sites[1]*sizeof(int);
+
+    start[0] = cacheAlign(sizeof(CacheHeader));
+    for(int s=0; s < CACHE_END; s++) 
+    { 
+        start[s+1] = start[s] + cacheAlign(bytes[s]);
+    }
+}
+
+/* FNV-1a */
+uint64_t hashSites(const std::vector<int>& v)
+{
+    uint64_t h = 14695981039346656037ull;
+    for(size_t i=0; i < v.size(); i++) 
+    { 
+        h = (h ^ (uint32_t)v[i])*1099511628211ull;
+    }
+    return h;
+}
+}
+
+void setShiftTableCache(const char* dir)
+{
+    cacheDirectory() = dir == 0 ? "" : dir;
+}
+
+template <typename T, int N>
+ShiftTable<T, N>::ShiftTable(
     const int* _subgrid_size,
     HalfSpinor* chi1, 
     HalfSpinor* chi2,
@@ -13,7 +100,9 @@ ShiftTable::ShiftTable(
     HalfSpinor* send_bufs[2][4],
     void (*getSiteCoords)(int coord[], int node, int linearsite), 
     int (*getLinearSiteIndex)(const int coord[]),
-    int (*getNodeNumber)(const int coord[])) : Nd(4)
+    int (*getNodeNumber)(const int coord[]),
+    SiteOrder order,
+    bool withNeighbours) : Nd(4)
 {
 
     /* Setup subgrid */
@@ -36,6 +125,43 @@ ShiftTable::ShiftTable(
     }
     subgrid_vol_cb = subgrid_vol/2;
 
+    cb_stride[0] = 1;
+    for(int mu=1; mu < 4; mu++) 
+    { 
+        cb_stride[mu] = cb_stride[mu-1]*subgrid_cb_size[mu-1];
+    }
+    for(int mu=0; mu < 4; mu++) 
+    { 
+        split[mu] = mach_size[mu] > 1;
+    }
+
+    buildSiteOrder(order);
+
+    const int *node_coord  = QMP_get_logical_coordinates();
+
+    node_parity = 0;
+    for(int mu=1; mu < 4; mu++) 
+    { 
+        node_parity += subgrid_size[mu]*node_coord[mu];
+    }
+
+    for(int i=0; i < NUM_OFFSET_BASES; i++)
+    {
+        offset_bases[i] = 0;
+    }
+    offset_bases[OFFSET_CHI1] = chi1;
+    offset_bases[OFFSET_CHI2] = chi2;
+
+    /* The tables of an earlier run on this geometry */
+    mapping = 0;
+    mapping_size = 0;
+    std::string cache_file = cacheFile(order, withNeighbours);
+    if (!cache_file.empty()
+        && loadCache(cache_file, recv_bufs, send_bufs, getLinearSiteIndex, order, withNeighbours))
+    {
+        return;
+    }
+
     /* Now I want to build the site table */
     /* I want it cache line aligned? */
     xsite_table = (int *)malloc(sizeof(int)*subgrid_vol+Cache::CacheLineSize);
@@ -92,8 +218,6 @@ ShiftTable::ShiftTable(
     /* Loop through sites - you can choose your path below */
     /* This is a checkerboarded order which is identical hopefully
        to QDP++'s rb2 subset when QDP++ is in a CB2 layout */
-    const int *node_coord  = QMP_get_logical_coordinates();
-
 #pragma omp parallel for collapse(5)	// loop2: OK
     for(int p=0; p < 2; p++) 
     {
@@ -138,6 +262,18 @@ ShiftTable::ShiftTable(
 //		}
     }
 
+    /* QDP++ in the same checkerboarded layout: the sweeps index the
+       fields directly */
+    sites_identity = true;
+    for(int i=0; i < subgrid_vol; i++) 
+    { 
+        if (site_table[i] != i) 
+        { 
+            sites_identity = false;
+            break;
+        }
+    }
+
     /* Site table transitivity check: 
        for each site, convert to index in cb3d, convert to qdp index
        convert qdp_index to coordinate
@@ -195,6 +331,22 @@ ShiftTable::ShiftTable(
                     continue;
                 }
             }
+
+            /* The coordinates the sweeps compute the neighbours from */
+            if (!lexicographic)
+            {
+                continue;
+            }
+            int lcoord[4];
+            siteCoords(p, my_index, lcoord);
+            for(int mu=0 ; mu < 4; mu++) 
+            { 
+                if( lcoord[mu] + subgrid_size[mu]*node_coord[mu] != gcoord[mu] ) 
+                {
+                    printf("P%d: my_index=%d coords=(%d,%d,%d,%d) local coords=(%d,%d,%d,%d)\n", my_node, my_index, gcoord[0], gcoord[1], gcoord[2], gcoord[3], lcoord[0], lcoord[1], lcoord[2], lcoord[3]);
+                    break;
+                }
+            }
         }
     }
 
@@ -239,6 +391,11 @@ ShiftTable::ShiftTable(
         }
     }
 
+    if (withNeighbours) 
+    {
+        neighbour_table.resize(8*subgrid_vol);
+    }
+
 /*
   JB: to implementation of threading requires us to make two passes, one of which is costly, but fully threaded, and the
   other with only two threads but cheap. In the first pass we will the offnode shift tables with -1, so that these sites can be 
@@ -276,6 +433,14 @@ ShiftTable::ShiftTable(
                 fnode   = getNodeNumber(fcoord);
                 flinear = getLinearSiteIndex(fcoord);
 
+                if (withNeighbours) 
+                {
+                    neighbour_table[8*index + dir] = fnode != my_node ? -1 
+                        : invtab[flinear].cb*subgrid_vol_cb + invtab[flinear].linearcb;
+                    neighbour_table[8*index + 4 + dir] = bnode != my_node ? -1 
+                        : invtab[blinear].cb*subgrid_vol_cb + invtab[blinear].linearcb;
+                }
+
                 /* Scatter:  decomp_{plus,minus} */
                 /* Operation: a^F(shift(x,type=0),dir) <- decomp(psi(x),dir) */ 
                 /* Send backwards - also called a receive from forward */
@@ -459,6 +624,45 @@ ShiftTable::ShiftTable(
         }
     }
 
+    /* Classify the target sites of each checkerboard by the directions
+       in which they gather from off node. The classes are stored one after
+       the other, so each phase of the dslash sweeps a contiguous range */
+    for(int cb=0; cb < 2; cb++)
+    {
+        std::vector<int> classified[NUM_TARGET_SITE_CLASSES];
+
+        for(int site=0; site < subgrid_vol_cb; ++site)
+        {
+            int index = cb*subgrid_vol_cb + site;
+            int fwd_dirs = 0;
+            int back_dirs = 0;
+
+            for(int dir=0; dir < 4; dir++)
+            {
+                if (shift_table[RECONS_MVV_GATHER][dir+4*index] >= 2*subgrid_vol_cb)
+                    fwd_dirs |= 1 << dir;
+                if (shift_table[RECONS_GATHER][dir+4*index] >= 2*subgrid_vol_cb)
+                    back_dirs |= 1 << dir;
+            }
+
+            if (back_dirs != 0)
+                classified[BOUNDARY_SITES].push_back(index);
+            else if (fwd_dirs != 0)
+                classified[FORWARD_BOUNDARY_SITES].push_back(index);
+            else
+                classified[INTERIOR_SITES].push_back(index);
+        }
+
+        target_sites[cb].reserve(subgrid_vol_cb);
+        for(int c=0; c < NUM_TARGET_SITE_CLASSES; c++)
+        {
+            target_sites_begin[cb][c] = target_sites[cb].size();
+            target_sites[cb].insert(target_sites[cb].end(),
+                                    classified[c].begin(), classified[c].end());
+        }
+        target_sites_begin[cb][NUM_TARGET_SITE_CLASSES] = target_sites[cb].size();
+    }
+
     /* Now I want to make the offset table into the half spinor temporaries */
     /* The half spinor temporaries will look like this:
        
@@ -487,8 +691,16 @@ ShiftTable::ShiftTable(
        
     */
 
+    /* The offsets are 32 bit (see OffsetBaseBits): the buffer they point
+       into and the half spinor in it. The body of chi1 / chi2 is the largest */
+    if (4*subgrid_vol_cb > (int)OffsetIndexMask)
+    {
+        QMP_error("init_wnxtsu3dslash: subgrid too large for the offset table");
+        QMP_abort(1);
+    }
+
     /* 4 dims, 4 types, rest of the magic is to align the thingie */
-    xoffset_table = (HalfSpinor **)malloc(4*4*subgrid_vol*sizeof(HalfSpinor*)+Cache::CacheLineSize);
+    xoffset_table = (uint32_t *)malloc(4*4*subgrid_vol*sizeof(uint32_t)+Cache::CacheLineSize);
     if( xoffset_table == 0 )
     {
         QMP_error("init_wnxtsu3dslash: could not initialize offset_table[i]");
@@ -502,9 +714,9 @@ ShiftTable::ShiftTable(
     }    
 
     /* This is the bit what aligns straight from AMD Manual */
-    offset_table = (HalfSpinor**)((unsigned char*)xoffset_table + pad);
-    /* Walk through the shift_table and remap the offsets into actual
-       pointers */
+    offset_table = (uint32_t*)((unsigned char*)xoffset_table + pad);
+    /* Walk through the shift_table and remap the offsets into buffers and
+       half spinors within them */
 
     /* DECOMP_SCATTER */
     int num=0;
@@ -512,6 +724,8 @@ ShiftTable::ShiftTable(
     int offset;
     for(int dir =0; dir < 4; dir++)
     {
+        offsite_found=0;
+
         /* Loop through all the sites. Remap the offsets either to local arrays or pointers */
 
 #pragma omp parallel for private(offset)		// loop6: OK
@@ -526,20 +740,23 @@ ShiftTable::ShiftTable(
                 offsite_found++;
 
                 offset_table[ dir + 4*(site + subgrid_vol*DECOMP_SCATTER) ] =
-                    send_bufs[0][num]+(offset - subgrid_vol_cb);
+                    offsetCode(OFFSET_SEND_BUFS + num, offset - subgrid_vol_cb);
             }
             else
             {
                 /* Guy is onsite: This is DECOMP_SCATTER so offset to chi1 */
                 offset_table[ dir + 4*(site + subgrid_vol*DECOMP_SCATTER) ] =
-                    chi1+shift_table[DECOMP_SCATTER][dir+4*site]+subgrid_vol_cb*dir;
+                    offsetCode(OFFSET_CHI1, shift_table[DECOMP_SCATTER][dir+4*site]+subgrid_vol_cb*dir);
             }
         }
       
         /* If we found an offsite guy, next direction has to 
            go into the next dir part of the send bufs */
         if( offsite_found > 0 ) 
+        {
+            offset_bases[OFFSET_SEND_BUFS + num] = send_bufs[0][num];
             num++; 
+        }
     }
     
     /* DECOMP_HVV_SCATTER */
@@ -561,18 +778,21 @@ ShiftTable::ShiftTable(
                 offsite_found++;
 
                 offset_table[ dir + 4*(site + subgrid_vol*DECOMP_HVV_SCATTER) ] =
-                    send_bufs[1][num]+(offset - subgrid_vol_cb);
+                    offsetCode(OFFSET_SEND_BUFS + 4 + num, offset - subgrid_vol_cb);
             }
             else 
             { 
                 /* Guy is onsite. This is DECOMP_HVV_SCATTER so offset to chi2 */
                 offset_table[ dir + 4*(site + subgrid_vol*DECOMP_HVV_SCATTER) ] =
-                    chi2+shift_table[DECOMP_HVV_SCATTER][dir+4*site ]+subgrid_vol_cb*dir;
+                    offsetCode(OFFSET_CHI2, shift_table[DECOMP_HVV_SCATTER][dir+4*site ]+subgrid_vol_cb*dir);
             }
         }
 
         if( offsite_found > 0 ) 
+        {
+            offset_bases[OFFSET_SEND_BUFS + 4 + num] = send_bufs[1][num];
             num++; 
+        }
     }
 
     /* RECONS_MVV_GATHER */
@@ -593,19 +813,22 @@ ShiftTable::ShiftTable(
                 offsite_found++;
 
                 offset_table[ dir + 4*(site + subgrid_vol*RECONS_MVV_GATHER) ] =
-                    recv_bufs[0][num]+(offset - 2*subgrid_vol_cb);
+                    offsetCode(OFFSET_RECV_BUFS + num, offset - 2*subgrid_vol_cb);
             }
             else 
             { 
                 /* Guy is onsite */
                 /* This is RECONS_MVV_GATHER so offset with respect to chi1 */
                 offset_table[ dir + 4*(site + subgrid_vol*RECONS_MVV_GATHER) ] =
-                    chi1+shift_table[RECONS_MVV_GATHER][dir+4*site ]+subgrid_vol_cb*dir;
+                    offsetCode(OFFSET_CHI1, shift_table[RECONS_MVV_GATHER][dir+4*site ]+subgrid_vol_cb*dir);
             }
         }
 
         if( offsite_found > 0 ) 
+        {
+            offset_bases[OFFSET_RECV_BUFS + num] = recv_bufs[0][num];
             num++; 
+        }
     }
 
     /* RECONS_GATHER */
@@ -625,19 +848,22 @@ ShiftTable::ShiftTable(
 #pragma omp atomic
                 offsite_found++;
                 offset_table[ dir + 4*(site + subgrid_vol*RECONS_GATHER) ] =
-                    recv_bufs[1][num]+(offset - 2*subgrid_vol_cb);
+                    offsetCode(OFFSET_RECV_BUFS + 4 + num, offset - 2*subgrid_vol_cb);
             }
             else 
             { 
                 /* Guy is onsite */
                 /* This is RECONS_GATHER so offset with respect to chi2 */
                 offset_table[ dir + 4*(site + subgrid_vol*RECONS_GATHER ) ] = 
-                    chi2+shift_table[RECONS_GATHER][dir+4*site ]+subgrid_vol_cb*dir;
+                    offsetCode(OFFSET_CHI2, shift_table[RECONS_GATHER][dir+4*site ]+subgrid_vol_cb*dir);
             }
         }
 
         if( offsite_found > 0 ) 
+        {
+            offset_bases[OFFSET_RECV_BUFS + 4 + num] = recv_bufs[1][num];
             num++; 
+        }
     }
 
     /* Free shift table - it is no longer needed. We deal solely with offsets */
@@ -649,6 +875,370 @@ ShiftTable::ShiftTable(
      
     free( invtab );
 
+    /* The sources the decomp has to do when the targets gather from their
+       neighbours themselves */
+    if (withNeighbours) 
+    {
+        for(int cb=0; cb < 2; cb++) 
+        { 
+            for(int site=0; site < subgrid_vol_cb; site++) 
+            { 
+                int index = cb*subgrid_vol_cb + site;
+                bool face = false;
+                for(int dir=0; dir < 4; dir++) 
+                { 
+                    face = face
+                        || (offset_table[dir + 4*(index + subgrid_vol*DECOMP_SCATTER)] >> OffsetIndexBits) >= OFFSET_SEND_BUFS
+                        || (offset_table[dir + 4*(index + subgrid_vol*DECOMP_HVV_SCATTER)] >> OffsetIndexBits) >= OFFSET_SEND_BUFS;
+                }
+                if (face) 
+                {
+                    face_sites[cb].push_back(index);
+                }
+            }
+        }
+    }
+
+    if (!cache_file.empty()) 
+    {
+        saveCache(cache_file, order, withNeighbours);
+    }
+}
+
+template <typename T, int N>
+ShiftTable<T, N>::~ShiftTable()
+{
+    free(xoffset_table);
+    free(xsite_table);
+    if (mapping != 0) 
+    {
+        munmap(mapping, mapping_size);
+    }
+}
+
+/* The name of the cache file of this rank, empty without a cache */
+template <typename T, int N>
+std::string ShiftTable<T, N>::cacheFile(SiteOrder order, bool withNeighbours)
+{
+    if (cacheDirectory().empty()) 
+    {
+        return "";
+    }
+    const int* mach_size = QMP_get_logical_dimensions();
+    char name[256];
+    snprintf(name, sizeof(name), "/shift_table_%dx%dx%dx%d_%dx%dx%dx%d_o%d%s_%016llx.%d",
+             subgrid_size[0], subgrid_size[1], subgrid_size[2], subgrid_size[3],
+             mach_size[0], mach_size[1], mach_size[2], mach_size[3],
+             (int)order, withNeighbours ? "n" : "",
+             (unsigned long long)hashSites(site_order), QMP_get_node_number());
+    return cacheDirectory() + name;
+}
+
+/* Map the cache file and point the tables into it. False, and nothing
+   changed, when there is none or it is of another geometry */
+template <typename T, int N>
+bool ShiftTable<T, N>::loadCache(const std::string& file, HalfSpinor* recv_bufs[2][4],
+                                 HalfSpinor* send_bufs[2][4],
+                                 int (*getLinearSiteIndex)(const int coord[]),
+                                 SiteOrder order, bool withNeighbours)
+{
+    int fd = open(file.c_str(), O_RDONLY);
+    if (fd < 0) 
+    {
+        return false;
+    }
+    struct stat st;
+    void* map = MAP_FAILED;
+    if (fstat(fd, &st) == 0 && (size_t)st.st_size >= sizeof(CacheHeader)) 
+    {
+        map = mmap(0, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    }
+    close(fd);
+    if (map == MAP_FAILED) 
+    {
+        return false;
+    }
+
+    const unsigned char* base = (const unsigned char*) map;
+    CacheHeader h;
+    std::memcpy(&h, base, sizeof(h));
+
+    const int* mach_size = QMP_get_logical_dimensions();
+    bool match = std::memcmp(h.magic, CacheMagic, sizeof(CacheMagic)) == 0
+        && h.node == QMP_get_node_number()
+        && h.order == (int)order
+        && h.neighbours == (int)withNeighbours
+        && h.order_hash == hashSites(site_order);
+    for(int mu=0; mu < 4; mu++) 
+    { 
+        match = match && h.subgrid[mu] == subgrid_size[mu] && h.machine[mu] == mach_size[mu];
+    }
+
+    size_t start[CACHE_END+1];
+    if (match) 
+    {
+        cacheSections(h, subgrid_vol, start);
+        match = start[CACHE_END] == (size_t)st.st_size;
+    }
+    if (!match) 
+    {
+        munmap(map, st.st_size);
+        return false;
+    }
+
+    /* The layout functions have to be those of the file: spot check them */
+    int* sites = (int*)(base + start[CACHE_SITE_TABLE]);
+    int my_node = QMP_get_node_number();
+    int step = std::max(1, subgrid_vol/64);
+    for(int i=0; i < subgrid_vol; i += step) 
+    { 
+        int gcoord[4];
+        mySiteCoords4D(gcoord, my_node, i);
+        if (getLinearSiteIndex(gcoord) != sites[i]) 
+        {
+            munmap(map, st.st_size);
+            return false;
+        }
+    }
+
+    mapping = map;
+    mapping_size = st.st_size;
+    xsite_table = 0;
+    xoffset_table = 0;
+    site_table = sites;
+    offset_table = (uint32_t*)(base + start[CACHE_OFFSET_TABLE]);
+
+    /* Rebase the offsets onto our buffers */
+    for(int i=0; i < 2; i++) 
+    { 
+        for(int num=0; num < 4; num++) 
+        { 
+            if (h.bases & (1u << (OFFSET_SEND_BUFS + 4*i + num))) 
+            {
+                offset_bases[OFFSET_SEND_BUFS + 4*i + num] = send_bufs[i][num];
+            }
+            if (h.bases & (1u << (OFFSET_RECV_BUFS + 4*i + num))) 
+            {
+                offset_bases[OFFSET_RECV_BUFS + 4*i + num] = recv_bufs[i][num];
+            }
+        }
+    }
+
+    const int* targets = (const int*)(base + start[CACHE_TARGET_SITES]);
+    for(int cb=0; cb < 2; cb++) 
+    { 
+        target_sites[cb].assign(targets + cb*subgrid_vol_cb, targets + (cb+1)*subgrid_vol_cb);
+        for(int c=0; c <= NUM_TARGET_SITE_CLASSES; c++) 
+        { 
+            target_sites_begin[cb][c] = h.target_sites_begin[cb][c];
+        }
+    }
+    if (withNeighbours) 
+    {
+        const int* nb = (const int*)(base + start[CACHE_NEIGHBOURS]);
+        neighbour_table.assign(nb, nb + 8*subgrid_vol);
+        for(int cb=0; cb < 2; cb++) 
+        { 
+            const int* face = (const int*)(base + start[CACHE_FACE_SITES_0 + cb]);
+            face_sites[cb].assign(face, face + h.num_face_sites[cb]);
+        }
+    }
+
+    sites_identity = true;
+    for(int i=0; i < subgrid_vol; i++) 
+    { 
+        if (site_table[i] != i) 
+        { 
+            sites_identity = false;
+            break;
+        }
+    }
+    return true;
 }
 
+/* Write the tables for the next run, to a temporary renamed into place so
+   concurrent jobs never see half a file. Failing to is not fatal */
+template <typename T, int N>
+void ShiftTable<T, N>::saveCache(const std::string& file, SiteOrder order, bool withNeighbours)
+{
+    CacheHeader h;
+    std::memset(&h, 0, sizeof(h));
+    std::memcpy(h.magic, CacheMagic, sizeof(CacheMagic));
+    const int* mach_size = QMP_get_logical_dimensions();
+    for(int mu=0; mu < 4; mu++) 
+    { 
+        h.subgrid[mu] = subgrid_size[mu];
+        h.machine[mu] = mach_size[mu];
+    }
+    h.node = QMP_get_node_number();
+    h.order = order;
+    h.neighbours = withNeighbours;
+    h.order_hash = hashSites(site_order);
+    for(int b=0; b < NUM_OFFSET_BASES; b++) 
+    { 
+        if (offset_bases[b] != 0) 
+        {
+            h.bases |= 1u << b;
+        }
+    }
+    for(int cb=0; cb < 2; cb++) 
+    { 
+        for(int c=0; c <= NUM_TARGET_SITE_CLASSES; c++) 
+        { 
+            h.target_sites_begin[cb][c] = target_sites_begin[cb][c];
+        }
+        h.num_face_sites[cb] = withNeighbours ? face_sites[cb].size() : 0;
+    }
+
+    size_t start[CACHE_END+1];
+    cacheSections(h, subgrid_vol, start);
+    std::vector<unsigned char> buf(start[CACHE_END], 0);
+    std::memcpy(&buf[0], &h, sizeof(h));
+    std::memcpy(&buf[start[CACHE_SITE_TABLE]], site_table, subgrid_vol*sizeof(int));
+    std::memcpy(&buf[start[CACHE_OFFSET_TABLE]], offset_table, 4*4*subgrid_vol*sizeof(uint32_t));
+    for(int cb=0; cb < 2; cb++) 
+    { 
+        std::memcpy(&buf[start[CACHE_TARGET_SITES] + cb*subgrid_vol_cb*sizeof(int)],
+                    target_sites[cb].data(), subgrid_vol_cb*sizeof(int));
+    }
+    if (withNeighbours) 
+    {
+        std::memcpy(&buf[start[CACHE_NEIGHBOURS]], neighbour_table.data(), 8*subgrid_vol*sizeof(int));
+        for(int cb=0; cb < 2; cb++) 
+        { 
+            std::memcpy(&buf[start[CACHE_FACE_SITES_0 + cb]], face_sites[cb].data(),
+                        face_sites[cb].size()*sizeof(int));
+        }
+    }
+
+    std::string tmp = file + ".tmp" + std::to_string((long)getpid());
+    FILE* fp = fopen(tmp.c_str(), "wb");
+    bool ok = fp != 0 && fwrite(buf.data(), 1, buf.size(), fp) == buf.size();
+    if (fp != 0) 
+    {
+        ok = fclose(fp) == 0 && ok;
+    }
+    if (!ok || rename(tmp.c_str(), file.c_str()) != 0) 
+    {
+        QMP_error("ShiftTable: could not write the cache %s", file.c_str());
+        remove(tmp.c_str());
+    }
+}
+
+/* The SiteOrder permutes the cb coordinates of both checkerboards alike:
+   the lexicographic cb index of a site -> its index in the sweeps and in
+   chi1 / chi2 */
+template <typename T, int N>
+void ShiftTable<T, N>::buildSiteOrder(SiteOrder order)
+{
+    lexicographic = order == SITE_ORDER_LEXICOGRAPHIC;
+    if (lexicographic) 
+    {
+        return;
+    }
+
+    site_order.resize(subgrid_vol_cb);
+    site_order_inv.resize(subgrid_vol_cb);
+
+    if (order == SITE_ORDER_TILED) 
+    {
+        /* Halve the longest tile extent until the sources, half spinors and
+           links of a tile fit in L2 */
+        int site_bytes = N*(sizeof(SpinorT<T>) + 8*sizeof(HalfSpinorT<T>))
+            + 4*sizeof(PackedGaugeT<T>);
+        int tile[4];
+        int tile_vol = subgrid_vol_cb;
+        for(int mu=0; mu < 4; mu++) 
+        { 
+            tile[mu] = subgrid_cb_size[mu];
+        }
+        while ((size_t)tile_vol*site_bytes > Cache::CacheL2Size) 
+        {
+            int longest = -1;
+            for(int mu=0; mu < 4; mu++) 
+            { 
+                if (tile[mu] % 2 == 0 && (longest < 0 || tile[mu] > tile[longest])) 
+                {
+                    longest = mu;
+                }
+            }
+            if (longest < 0) 
+            {
+                break;
+            }
+            tile[longest] /= 2;
+            tile_vol /= 2;
+        }
+
+        int ntiles[4];
+        for(int mu=0; mu < 4; mu++) 
+        { 
+            ntiles[mu] = subgrid_cb_size[mu]/tile[mu];
+        }
+
+        for(int lex=0; lex < subgrid_vol_cb; lex++) 
+        { 
+            int coord[4];
+            int tcoord[4];
+            int wcoord[4];
+            crtesn4d(lex, subgrid_cb_size, coord);
+            for(int mu=0; mu < 4; mu++) 
+            { 
+                tcoord[mu] = coord[mu]/tile[mu];
+                wcoord[mu] = coord[mu]%tile[mu];
+            }
+            site_order[lex] = localSite4d(tcoord, ntiles)*tile_vol + localSite4d(wcoord, tile);
+        }
+    }
+    else 
+    {
+        /* Rank the sites by the interleaved bits of their coordinates */
+        std::vector<uint64_t> key(subgrid_vol_cb);
+        std::vector<int> lex_of(subgrid_vol_cb);
+        for(int lex=0; lex < subgrid_vol_cb; lex++) 
+        { 
+            int coord[4];
+            crtesn4d(lex, subgrid_cb_size, coord);
+            uint64_t k = 0;
+            for(int bit=0; bit < 16; bit++) 
+            { 
+                for(int mu=0; mu < 4; mu++) 
+                { 
+                    k |= (uint64_t)((coord[mu] >> bit) & 1) << (4*bit + mu);
+                }
+            }
+            key[lex] = k;
+            lex_of[lex] = lex;
+        }
+        std::sort(lex_of.begin(), lex_of.end(),
+                  [&key](int a, int b) { return key[a] < key[b]; });
+        for(int i=0; i < subgrid_vol_cb; i++) 
+        { 
+            site_order[lex_of[i]] = i;
+        }
+    }
+
+    for(int lex=0; lex < subgrid_vol_cb; lex++) 
+    { 
+        site_order_inv[site_order[lex]] = lex;
+    }
+}
+
+template class ShiftTable<float, 1>;
+template class ShiftTable<float, 2>;
+template class ShiftTable<float, 4>;
+template class ShiftTable<float, 8>;
+template class ShiftTable<float, 12>;
+template class ShiftTable<float, 16>;
+template class ShiftTable<float, 20>;
+template class ShiftTable<float, 24>;
+template class ShiftTable<double, 1>;
+template class ShiftTable<double, 2>;
+template class ShiftTable<double, 4>;
+template class ShiftTable<double, 8>;
+template class ShiftTable<double, 12>;
+template class ShiftTable<double, 16>;
+template class ShiftTable<double, 20>;
+template class ShiftTable<double, 24>;
+
 } // namespace Chroma